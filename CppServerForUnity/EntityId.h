@@ -0,0 +1,26 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+// 플레이어 식별자
+// Compact numeric id of a connected player, used for every lookup and in binary messages (a varint
+// in Encoding::Schema). JSON clients see it as the string "UID<n>", as they always have; that
+// string is built only when a JSON message or a log line needs it. The value is n + 1 so that 0
+// can mean no player, which is written to JSON as "".
+struct EntityId
+{
+    std::uint32_t value = 0;
+
+    explicit operator bool() const { return value != 0; }
+    friend bool operator==(EntityId a, EntityId b) { return a.value == b.value; }
+    friend bool operator!=(EntityId a, EntityId b) { return a.value != b.value; }
+};
+
+constexpr std::string_view kEntityIdPrefix = "UID";
+
+inline std::string to_string(EntityId id)
+{
+    return id ? std::string(kEntityIdPrefix) + std::to_string(id.value - 1) : std::string();
+}
@@ -0,0 +1,231 @@
+#include "FrameCompression.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+// Lobby messages as JSON and Schema clients see them. Must match FrameCompression.Dictionary in
+// NetworkModels.cs byte for byte; changing it is a new capability version.
+const std::string_view kCompressionDictionary =
+    "{\"message\":\"\",\"sender_id\":\"UID\",\"type\":\"chat_broadcast\"}"
+    "{\"host_id\":\"UID\",\"players\":[{\"is_ready\":true,\"nickname\":\"\",\"player_id\":\"UID\"},"
+    "{\"is_ready\":false,\"nickname\":\"\",\"player_id\":\"UID\"}],\"room_name\":\"\",\"type\":\"update_room_info\"}"
+    "{\"rooms\":[{\"player_count\":1,\"room_id\":0,\"room_name\":\"\"},"
+    "{\"player_count\":2,\"room_id\":1,\"room_name\":\"\"}],\"type\":\"find_rooms_response\"}";
+
+namespace
+{
+    constexpr std::size_t kMinMatch = 4;
+    constexpr std::size_t kMaxOffset = 65535;
+    constexpr int kHashBits = 14;
+    constexpr std::uint32_t kNoPosition = UINT32_MAX;
+
+    std::uint32_t read32(const char *p)
+    {
+        std::uint32_t value;
+        std::memcpy(&value, p, sizeof(value));
+        return value;
+    }
+
+    std::size_t hash4(const char *p)
+    {
+        return (read32(p) * 2654435761u) >> (32 - kHashBits);
+    }
+
+    void write_length(std::string &out, std::size_t length)
+    {
+        for (; length >= 255; length -= 255)
+        {
+            out.push_back(static_cast<char>(255));
+        }
+        out.push_back(static_cast<char>(length));
+    }
+
+    // A sequence with match_length 0 is the last one.
+    void append_sequence(std::string &out, std::string_view literals, std::size_t offset, std::size_t match_length)
+    {
+        const std::size_t extra = match_length ? match_length - kMinMatch : 0;
+        out.push_back(static_cast<char>(std::min<std::size_t>(literals.size(), 15) << 4 | std::min<std::size_t>(extra, 15)));
+        if (literals.size() >= 15)
+        {
+            write_length(out, literals.size() - 15);
+        }
+        out.append(literals);
+        if (match_length)
+        {
+            out.push_back(static_cast<char>(offset));
+            out.push_back(static_cast<char>(offset >> 8));
+            if (extra >= 15)
+            {
+                write_length(out, extra - 15);
+            }
+        }
+    }
+
+    bool read_length(std::string_view in, std::size_t &i, std::size_t &length)
+    {
+        std::uint8_t byte;
+        do
+        {
+            if (i >= in.size())
+            {
+                return false;
+            }
+            byte = static_cast<std::uint8_t>(in[i++]);
+            length += byte;
+        } while (byte == 255);
+        return true;
+    }
+}
+
+// Greedy LZ77 over the dictionary followed by the payload, finding matches through a hash of the
+// next four bytes that remembers the latest position of each.
+std::string compress_frame(std::string_view payload)
+{
+    std::string window;
+    window.reserve(kCompressionDictionary.size() + payload.size());
+    window.append(kCompressionDictionary);
+    window.append(payload);
+    const char *data = window.data();
+    const std::size_t end = window.size();
+
+    std::vector<std::uint32_t> table(std::size_t(1) << kHashBits, kNoPosition);
+    auto insert = [&](std::size_t pos)
+    {
+        table[hash4(data + pos)] = static_cast<std::uint32_t>(pos);
+    };
+    for (std::size_t pos = 0; pos + kMinMatch <= kCompressionDictionary.size(); ++pos)
+    {
+        insert(pos);
+    }
+
+    std::string out;
+    out.reserve(payload.size() / 2);
+    for (std::uint64_t size = payload.size(); ; size >>= 7)
+    {
+        if (size < 0x80)
+        {
+            out.push_back(static_cast<char>(size));
+            break;
+        }
+        out.push_back(static_cast<char>(size | 0x80));
+    }
+
+    std::size_t anchor = kCompressionDictionary.size(); // first byte not yet written
+    std::size_t pos = anchor;
+    while (pos + kMinMatch <= end)
+    {
+        const std::uint32_t candidate = table[hash4(data + pos)];
+        insert(pos);
+        if (candidate == kNoPosition || pos - candidate > kMaxOffset || read32(data + candidate) != read32(data + pos))
+        {
+            ++pos;
+            continue;
+        }
+
+        std::size_t length = kMinMatch;
+        while (pos + length < end && data[candidate + length] == data[pos + length])
+        {
+            ++length;
+        }
+        append_sequence(out, std::string_view(data + anchor, pos - anchor), pos - candidate, length);
+        for (std::size_t i = pos + 1; i < pos + length && i + kMinMatch <= end; ++i)
+        {
+            insert(i);
+        }
+        pos += length;
+        anchor = pos;
+        if (out.size() >= payload.size())
+        {
+            return {};
+        }
+    }
+    append_sequence(out, std::string_view(data + anchor, end - anchor), 0, 0);
+
+    if (out.size() >= payload.size())
+    {
+        return {};
+    }
+    return out;
+}
+
+bool decompress_frame(std::string_view payload, std::string &out, std::size_t max_size)
+{
+    std::size_t i = 0;
+    std::uint64_t size = 0;
+    for (int shift = 0;; shift += 7)
+    {
+        if (i >= payload.size() || shift > 63)
+        {
+            return false;
+        }
+        const auto byte = static_cast<std::uint8_t>(payload[i++]);
+        size |= static_cast<std::uint64_t>(byte & 0x7f) << shift;
+        if (!(byte & 0x80))
+        {
+            break;
+        }
+    }
+    if (size > max_size)
+    {
+        return false;
+    }
+
+    // The dictionary is decoded output that precedes the payload's own.
+    const std::size_t start = kCompressionDictionary.size();
+    out.assign(kCompressionDictionary);
+    out.reserve(start + size);
+    while (true)
+    {
+        if (i >= payload.size())
+        {
+            return false;
+        }
+        const auto token = static_cast<std::uint8_t>(payload[i++]);
+
+        std::size_t literals = token >> 4;
+        if (literals == 15 && !read_length(payload, i, literals))
+        {
+            return false;
+        }
+        if (literals > payload.size() - i || out.size() - start + literals > size)
+        {
+            return false;
+        }
+        out.append(payload.data() + i, literals);
+        i += literals;
+        if (i == payload.size())
+        {
+            break;
+        }
+
+        if (payload.size() - i < 2)
+        {
+            return false;
+        }
+        const std::size_t offset = static_cast<std::uint8_t>(payload[i]) | static_cast<std::uint8_t>(payload[i + 1]) << 8;
+        i += 2;
+        std::size_t length = token & 0x0f;
+        if (length == 15 && !read_length(payload, i, length))
+        {
+            return false;
+        }
+        length += kMinMatch;
+        if (offset == 0 || offset > out.size() || out.size() - start + length > size)
+        {
+            return false;
+        }
+        // Byte by byte: a match may overlap the bytes it produces.
+        for (std::size_t from = out.size() - offset, k = 0; k < length; ++k)
+        {
+            out.push_back(out[from + k]);
+        }
+    }
+
+    if (out.size() - start != size)
+    {
+        return false;
+    }
+    out.erase(0, start);
+    return true;
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+// 프레임 압축
+// Optional compression of binary frames, for the lobby payloads that grow with the number of
+// rooms or players (find_rooms_response, update_room_info). A client asks for it by appending
+// kCompressionCapability to its framing hello ("GF-SCHEMA/1 lz/1"); the server echoes the
+// capabilities it accepted. Once both sides have it, either may send any frame compressed, marked
+// by kCompressedFrameFlag in the frame's message type (see Protocol.h). The server compresses
+// frames of at least kCompressionThreshold bytes, never game_state_update.
+//
+// A compressed payload is a varint with the uncompressed size, then LZ77 sequences:
+//   u8               token: high nibble literal count, low nibble match length - 4
+//   [u8...]          literal count - 15 in 255-steps when the nibble is 15, ending with a byte < 255
+//   literals
+//   u16 offset       little-endian, 1..65535, back from the current output position
+//   [u8...]          match length - 19 in 255-steps when the nibble is 15, as above
+// The last sequence has literals only and ends the payload. Offsets may reach back past the start
+// of the output into kCompressionDictionary, which both sides treat as already decoded: it holds
+// the keys and type names every lobby message repeats, so even the first room in a list is short.
+
+constexpr std::string_view kCompressionCapability = "lz/1";
+constexpr std::size_t kCompressionThreshold = 512;
+
+extern const std::string_view kCompressionDictionary;
+
+// `payload` compressed, or empty when that would not make it smaller.
+std::string compress_frame(std::string_view payload);
+
+// Decompresses `payload` into `out`. Returns false if it is malformed or would decompress to more
+// than `max_size` bytes.
+bool decompress_frame(std::string_view payload, std::string &out, std::size_t max_size);
@@ -0,0 +1,136 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+#include "nlohmann/json.hpp"
+
+// 요청 파싱용 아레나
+// Bump allocator that hands out memory from a few large blocks and frees it all at once.
+// reset() keeps the memory: once the arena has grown to fit the largest message it sees,
+// parsing never touches the global heap again.
+class MonotonicArena
+{
+public:
+    explicit MonotonicArena(std::size_t capacity = 16 * 1024) { add_block(capacity); }
+
+    void *allocate(std::size_t size, std::size_t alignment)
+    {
+        if (void *p = bump(size, alignment))
+        {
+            return p;
+        }
+        // Each new block at least doubles the arena.
+        add_block(std::max(size + alignment, capacity_));
+        return bump(size, alignment);
+    }
+
+    // Forgets every allocation. Memory that spilled into extra blocks is merged into one block
+    // of the combined size, up to kMaxRetained, so the next message of the same size needs one.
+    void reset()
+    {
+        if (blocks_.size() > 1)
+        {
+            const std::size_t capacity = std::min(capacity_, kMaxRetained);
+            blocks_.clear();
+            capacity_ = 0;
+            add_block(capacity);
+        }
+        cursor_ = blocks_.front().get();
+    }
+
+private:
+    static constexpr std::size_t kMaxRetained = 1024 * 1024;
+
+    void *bump(std::size_t size, std::size_t alignment)
+    {
+        void *p = cursor_;
+        std::size_t space = static_cast<std::size_t>(limit_ - cursor_);
+        if (!std::align(alignment, size, p, space))
+        {
+            return nullptr;
+        }
+        cursor_ = static_cast<char *>(p) + size;
+        return p;
+    }
+
+    void add_block(std::size_t size)
+    {
+        blocks_.emplace_back(new char[size]);
+        capacity_ += size;
+        cursor_ = blocks_.back().get();
+        limit_ = cursor_ + size;
+    }
+
+    std::vector<std::unique_ptr<char[]>> blocks_;
+    std::size_t capacity_ = 0; // 모든 블록 크기의 합
+    char *cursor_ = nullptr;   // 현재 블록의 다음 할당 위치
+    char *limit_ = nullptr;    // 현재 블록의 끝
+};
+
+// Makes the calling thread's arena the allocation source of every request_json created until the
+// scope ends, then resets the arena. Each io thread has its own arena, so parsing on one thread
+// never contends with another on the heap. A request_json must not outlive the scope it was
+// created in.
+class JsonArenaScope
+{
+public:
+    JsonArenaScope() { active_ = &arena(); }
+    ~JsonArenaScope()
+    {
+        active_ = nullptr;
+        arena().reset();
+    }
+    JsonArenaScope(const JsonArenaScope &) = delete;
+    JsonArenaScope &operator=(const JsonArenaScope &) = delete;
+
+    // The arena of the enclosing scope, or null outside one.
+    static MonotonicArena *active() { return active_; }
+
+private:
+    static MonotonicArena &arena()
+    {
+        thread_local MonotonicArena arena;
+        return arena;
+    }
+
+    static inline thread_local MonotonicArena *active_ = nullptr;
+};
+
+// Stateless allocator that draws from the active JsonArenaScope, or from the heap outside one.
+// Arena memory is only ever released by the scope, so deallocate() ignores it.
+template <class T>
+struct JsonArenaAllocator
+{
+    using value_type = T;
+
+    JsonArenaAllocator() noexcept = default;
+    template <class U>
+    JsonArenaAllocator(const JsonArenaAllocator<U> &) noexcept {}
+
+    T *allocate(std::size_t n)
+    {
+        if (MonotonicArena *arena = JsonArenaScope::active())
+        {
+            return static_cast<T *>(arena->allocate(n * sizeof(T), alignof(T)));
+        }
+        return std::allocator<T>().allocate(n);
+    }
+
+    void deallocate(T *p, std::size_t n) noexcept
+    {
+        if (!JsonArenaScope::active())
+        {
+            std::allocator<T>().deallocate(p, n);
+        }
+    }
+
+    friend bool operator==(const JsonArenaAllocator &, const JsonArenaAllocator &) { return true; }
+    friend bool operator!=(const JsonArenaAllocator &, const JsonArenaAllocator &) { return false; }
+};
+
+// A parsed request. Objects, arrays and strings all live in the arena.
+using arena_string = std::basic_string<char, std::char_traits<char>, JsonArenaAllocator<char>>;
+using request_json = nlohmann::basic_json<std::map, std::vector, arena_string, bool, std::int64_t, std::uint64_t, double, JsonArenaAllocator>;
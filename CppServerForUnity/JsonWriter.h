@@ -0,0 +1,83 @@
+#pragma once
+
+#include "stdafx.h"
+#include <charconv>
+#include <cmath>
+#include <string_view>
+
+// DOM 없이 JSON을 직접 쓰는 스트리밍 라이터
+// Appends JSON tokens to a caller-owned buffer, formatting scalars exactly as json::dump() does,
+// so a message written here is byte-identical to the same message built as a json and dumped.
+// The caller supplies structure and commas; keys must be written in sorted order to match dump().
+// Strings are expected to be valid UTF-8 (json::parse and the schema decoder both enforce it).
+class JsonWriter
+{
+public:
+    explicit JsonWriter(std::string &out) : out_(out) {}
+
+    void raw(std::string_view text) { out_.append(text); }
+    void raw(char c) { out_.push_back(c); }
+
+    // "name":
+    void key(std::string_view name)
+    {
+        string(name);
+        out_.push_back(':');
+    }
+
+    void string(std::string_view value)
+    {
+        out_.push_back('"');
+        for (const char c : value)
+        {
+            switch (c)
+            {
+            case '\b': out_.append("\\b"); break;
+            case '\t': out_.append("\\t"); break;
+            case '\n': out_.append("\\n"); break;
+            case '\f': out_.append("\\f"); break;
+            case '\r': out_.append("\\r"); break;
+            case '"': out_.append("\\\""); break;
+            case '\\': out_.append("\\\\"); break;
+            default:
+                if (static_cast<unsigned char>(c) <= 0x1f)
+                {
+                    static constexpr char kHex[] = "0123456789abcdef";
+                    const char escaped[] = {'\\', 'u', '0', '0', kHex[(c >> 4) & 0xf], kHex[c & 0xf]};
+                    out_.append(escaped, sizeof(escaped));
+                }
+                else
+                {
+                    out_.push_back(c);
+                }
+            }
+        }
+        out_.push_back('"');
+    }
+
+    void boolean(bool value) { out_.append(value ? "true" : "false"); }
+
+    template <class Integer>
+    void integer(Integer value)
+    {
+        char buffer[24];
+        const auto result = std::to_chars(buffer, buffer + sizeof(buffer), value);
+        out_.append(buffer, static_cast<std::size_t>(result.ptr - buffer));
+    }
+
+    // Floats are widened to double first, as storing one in a json does.
+    void number(double value)
+    {
+        if (!std::isfinite(value))
+        {
+            out_.append("null");
+            return;
+        }
+        char buffer[64];
+        const char *end = nlohmann::detail::to_chars(buffer, buffer + sizeof(buffer), value);
+        out_.append(buffer, static_cast<std::size_t>(end - buffer));
+    }
+
+private:
+    std::string &out_;
+};
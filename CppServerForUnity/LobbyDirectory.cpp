@@ -0,0 +1,46 @@
+#include "LobbyDirectory.h"
+#include "Session.h"
+#include "SchemaCodec.h"
+
+LobbyDirectory::LobbyDirectory(asio::io_context &io_context, int shard_count)
+    : strand_(io_context.get_executor()), shards_(shard_count, nullptr)
+{
+}
+
+void LobbyDirectory::publish_room(int room_id, const std::string &name, std::size_t player_count)
+{
+    asio::post(strand_, [this, room_id, name, player_count]()
+               {
+        RoomEntry &entry = rooms_[room_id];
+        entry.name = name;
+        entry.player_count = player_count;
+        ++entry.version;
+        ++rooms_version_; });
+}
+
+void LobbyDirectory::remove_room(int room_id)
+{
+    asio::post(strand_, [this, room_id]()
+               {
+        rooms_.erase(room_id);
+        ++rooms_version_; });
+}
+
+void LobbyDirectory::send_room_list(std::shared_ptr<Session> session)
+{
+    asio::post(strand_, [this, session = std::move(session)]()
+               {
+        // Rebuilt only after a room changed, and then only the changed rooms are re-serialized.
+        if (room_list_version_ != rooms_version_)
+        {
+            FragmentList rooms;
+            rooms.reserve(rooms_.size());
+            for (auto &[id, room] : rooms_)
+            {
+                rooms.push_back(room.listing.refresh(room.version, RoomInfo{id, room.name, static_cast<int>(room.player_count)}));
+            }
+            room_list_ = make_room_list(std::move(rooms));
+            room_list_version_ = rooms_version_;
+        }
+        session->write(room_list_); });
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include "stdafx.h"
+#include "Message.h"
+#include "SerializedFragment.h"
+
+class Server;
+class Session;
+
+// 샤드 간에 공유하는 로비 정보
+// Cross-shard lobby state for sharded mode: the room list every shard's find_rooms answers from,
+// and the shard table used to hand a player over to the shard that owns a room.
+// Shards publish room changes here; all state lives on strand_.
+class LobbyDirectory
+{
+public:
+    LobbyDirectory(asio::io_context &io_context, int shard_count);
+
+    void set_shard(int index, Server &shard) { shards_[index] = &shard; }
+    Server &shard(int index) { return *shards_[index]; }
+    int shard_count() const { return static_cast<int>(shards_.size()); }
+
+    void publish_room(int room_id, const std::string &name, std::size_t player_count);
+    void remove_room(int room_id);
+
+    // Sends a find_rooms_response listing the rooms of every shard.
+    void send_room_list(std::shared_ptr<Session> session);
+
+private:
+    struct RoomEntry
+    {
+        std::string name;
+        std::size_t player_count = 0;
+        std::uint64_t version = 0;
+        SerializedFragment listing; // RoomInfo, rebuilt when version moves
+    };
+
+    asio::strand<asio::io_context::executor_type> strand_;
+    std::vector<Server *> shards_; // filled as shards are constructed, read-only once they start
+    std::map<int, RoomEntry> rooms_;
+    std::uint64_t rooms_version_ = 1;     // bumped on every publish_room / remove_room
+    std::uint64_t room_list_version_ = 0; // rooms_version_ that room_list_ was built at
+    OutboundMessage room_list_;
+};
@@ -0,0 +1,134 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "FrameCompression.h"
+#include "Protocol.h"
+
+// 송신용 불변 메시지 버퍼
+// Reference-counted, immutable payload. A room fan-out serializes once and every
+// recipient's send queue holds a reference to the same bytes.
+using SharedMessage = std::shared_ptr<const std::string>;
+
+inline SharedMessage make_message(std::string payload)
+{
+    return std::make_shared<const std::string>(std::move(payload));
+}
+
+// 재사용 송신 버퍼
+// Payload buffers for a message that one strand builds over and over, like a room's snapshot.
+// acquire() hands out a buffer that no message sent earlier still refers to, cleared but with its
+// capacity; the caller fills it and sends it as the SharedMessage itself, without a copy. A buffer
+// comes back once every session has let go of it. Up to kMaxBuffers are kept; beyond that a
+// buffer is used once and freed.
+class MessageBufferPool
+{
+public:
+    std::shared_ptr<std::string> acquire()
+    {
+        for (const auto &buffer : buffers_)
+        {
+            if (buffer.use_count() == 1)
+            {
+                // Sessions release it on their own threads; see everything they did with it.
+                std::atomic_thread_fence(std::memory_order_acquire);
+                buffer->clear();
+                return buffer;
+            }
+        }
+        auto buffer = std::make_shared<std::string>();
+        if (buffers_.size() < kMaxBuffers)
+        {
+            buffers_.push_back(buffer);
+        }
+        return buffer;
+    }
+
+private:
+    static constexpr std::size_t kMaxBuffers = 16;
+    std::vector<std::shared_ptr<std::string>> buffers_;
+};
+
+// The payloads of one OutboundMessage, shared by all its copies. Each encoding is serialized by
+// the first sender whose peer uses it and compressed by the first that sends it compressed; the
+// rest reuse the result, and an encoding no recipient uses is never built.
+struct MessagePayloads
+{
+    std::function<std::string(Encoding)> encode; // null once both payloads are set
+    bool compressible = false;                   // lobby messages; see compressed_payload()
+    std::once_flag encoded[2];
+    SharedMessage payload[2];
+    std::once_flag compressed_once[2];
+    SharedMessage compressed[2]; // null when compression would not make it smaller
+};
+
+// One outgoing message in every payload encoding. The sender picks the one its peer negotiated.
+struct OutboundMessage
+{
+    MessageType type = MessageType::Unknown;
+    std::shared_ptr<MessagePayloads> payloads;
+
+    // Safe to call from any thread.
+    const SharedMessage &payload(Encoding encoding) const
+    {
+        const auto index = static_cast<std::size_t>(encoding);
+        std::call_once(payloads->encoded[index], [&]
+                       { payloads->payload[index] = make_message(payloads->encode(encoding)); });
+        return payloads->payload[index];
+    }
+
+    // payload(encoding) compressed (see FrameCompression.h), or null to send it as is. Only lobby
+    // messages of kCompressionThreshold bytes or more are compressed.
+    SharedMessage compressed_payload(Encoding encoding) const
+    {
+        if (!payloads->compressible)
+        {
+            return nullptr;
+        }
+        const auto index = static_cast<std::size_t>(encoding);
+        std::call_once(payloads->compressed_once[index], [&]
+                       {
+            const SharedMessage &plain = payload(encoding);
+            if (plain->size() < kCompressionThreshold)
+            {
+                return;
+            }
+            std::string packed = compress_frame(*plain);
+            if (!packed.empty())
+            {
+                payloads->compressed[index] = make_message(std::move(packed));
+            } });
+        return payloads->compressed[index];
+    }
+};
+
+// A lobby message, serialized by `encode` once per encoding that is actually sent.
+inline OutboundMessage make_outbound_message(MessageType type, std::function<std::string(Encoding)> encode)
+{
+    OutboundMessage message;
+    message.type = type;
+    message.payloads = std::make_shared<MessagePayloads>();
+    message.payloads->encode = std::move(encode);
+    message.payloads->compressible = true;
+    return message;
+}
+
+// A message whose payloads are already built, like a snapshot. It is never compressed.
+inline OutboundMessage make_outbound_message(MessageType type, SharedMessage json_text, SharedMessage schema_bytes)
+{
+    OutboundMessage message;
+    message.type = type;
+    message.payloads = std::make_shared<MessagePayloads>();
+    SharedMessage given[2] = {std::move(json_text), std::move(schema_bytes)};
+    for (std::size_t index = 0; index < 2; ++index)
+    {
+        std::call_once(message.payloads->encoded[index], [&]
+                       { message.payloads->payload[index] = std::move(given[index]); });
+    }
+    return message;
+}
@@ -0,0 +1,135 @@
+#include "MovementKernel.h"
+#include <cmath>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define GF_MOVEMENT_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#define GF_TARGET_AVX2
+#else
+#define GF_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#endif
+
+namespace
+{
+    constexpr float kDeadZone = 0.01f; // inputs no longer than this are not normalized
+
+    void integrate_range(const MovementBatch &batch, std::size_t begin, float distance)
+    {
+        for (std::size_t i = begin; i < batch.count; ++i)
+        {
+            float dx = batch.input_h[i];
+            float dz = batch.input_v[i];
+            const float length = std::sqrt(dx * dx + dz * dz);
+            if (length > kDeadZone)
+            {
+                dx /= length;
+                dz /= length;
+            }
+            batch.x[i] += dx * distance;
+            batch.z[i] += dz * distance;
+        }
+    }
+
+#ifdef GF_MOVEMENT_X86
+    // The branch becomes a select: every lane divides, and lanes inside the dead zone keep the
+    // raw input. sqrt and division are correctly rounded in SSE and AVX, as in std::sqrt.
+    void integrate_sse2(const MovementBatch &batch, float distance)
+    {
+        const __m128 dead_zone = _mm_set1_ps(kDeadZone);
+        const __m128 step = _mm_set1_ps(distance);
+        std::size_t i = 0;
+        for (; i + 4 <= batch.count; i += 4)
+        {
+            const __m128 h = _mm_loadu_ps(batch.input_h + i);
+            const __m128 v = _mm_loadu_ps(batch.input_v + i);
+            const __m128 length = _mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(h, h), _mm_mul_ps(v, v)));
+            const __m128 normalize = _mm_cmpgt_ps(length, dead_zone);
+            const __m128 dx = _mm_or_ps(_mm_and_ps(normalize, _mm_div_ps(h, length)), _mm_andnot_ps(normalize, h));
+            const __m128 dz = _mm_or_ps(_mm_and_ps(normalize, _mm_div_ps(v, length)), _mm_andnot_ps(normalize, v));
+            _mm_storeu_ps(batch.x + i, _mm_add_ps(_mm_loadu_ps(batch.x + i), _mm_mul_ps(dx, step)));
+            _mm_storeu_ps(batch.z + i, _mm_add_ps(_mm_loadu_ps(batch.z + i), _mm_mul_ps(dz, step)));
+        }
+        integrate_range(batch, i, distance);
+    }
+
+    GF_TARGET_AVX2 void integrate_avx2(const MovementBatch &batch, float distance)
+    {
+        const __m256 dead_zone = _mm256_set1_ps(kDeadZone);
+        const __m256 step = _mm256_set1_ps(distance);
+        std::size_t i = 0;
+        for (; i + 8 <= batch.count; i += 8)
+        {
+            const __m256 h = _mm256_loadu_ps(batch.input_h + i);
+            const __m256 v = _mm256_loadu_ps(batch.input_v + i);
+            const __m256 length = _mm256_sqrt_ps(_mm256_add_ps(_mm256_mul_ps(h, h), _mm256_mul_ps(v, v)));
+            const __m256 normalize = _mm256_cmp_ps(length, dead_zone, _CMP_GT_OQ);
+            const __m256 dx = _mm256_blendv_ps(h, _mm256_div_ps(h, length), normalize);
+            const __m256 dz = _mm256_blendv_ps(v, _mm256_div_ps(v, length), normalize);
+            _mm256_storeu_ps(batch.x + i, _mm256_add_ps(_mm256_loadu_ps(batch.x + i), _mm256_mul_ps(dx, step)));
+            _mm256_storeu_ps(batch.z + i, _mm256_add_ps(_mm256_loadu_ps(batch.z + i), _mm256_mul_ps(dz, step)));
+        }
+        integrate_range(batch, i, distance);
+    }
+
+    bool cpu_has_avx2()
+    {
+#if defined(_MSC_VER) && !defined(__clang__)
+        int info[4];
+        __cpuid(info, 1);
+        const bool os_saves_ymm = (info[2] & (1 << 27)) && (_xgetbv(0) & 0x6) == 0x6; // OSXSAVE, XMM+YMM state
+        __cpuidex(info, 7, 0);
+        return os_saves_ymm && (info[1] & (1 << 5));
+#else
+        return __builtin_cpu_supports("avx2");
+#endif
+    }
+#endif
+
+    const MovementKernel &selected_kernel()
+    {
+        static const MovementKernel kernel = []() -> MovementKernel
+        {
+#ifdef GF_MOVEMENT_X86
+            if (cpu_has_avx2())
+            {
+                return {integrate_avx2, "avx2"};
+            }
+            return {integrate_sse2, "sse2"}; // part of x86-64
+#else
+            return {integrate_movement_scalar, "scalar"};
+#endif
+        }();
+        return kernel;
+    }
+}
+
+void integrate_movement(const MovementBatch &batch, float distance)
+{
+    selected_kernel().integrate(batch, distance);
+}
+
+void integrate_movement_scalar(const MovementBatch &batch, float distance)
+{
+    integrate_range(batch, 0, distance);
+}
+
+const char *movement_kernel_name()
+{
+    return selected_kernel().name;
+}
+
+std::vector<MovementKernel> available_movement_kernels()
+{
+    std::vector<MovementKernel> kernels = {{integrate_movement_scalar, "scalar"}};
+#ifdef GF_MOVEMENT_X86
+    kernels.push_back({integrate_sse2, "sse2"});
+    if (cpu_has_avx2())
+    {
+        kernels.push_back({integrate_avx2, "avx2"});
+    }
+#endif
+    return kernels;
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+// 이동 적분 커널
+// The movement step of a tick: each entry moves `distance` along its input direction
+// {input_h, 0, input_v}, normalized when it is longer than a small dead zone.
+//
+// integrate_movement() runs the widest kernel the CPU supports (AVX2, SSE2, or scalar), picked
+// once at first use. Every kernel computes exactly what integrate_movement_scalar() does, in the
+// same order with the same IEEE single-precision operations, so results are bit for bit identical
+// on any machine. That needs multiply-add contraction disabled for MovementKernel.cpp
+// (see CMakeLists.txt).
+struct MovementBatch
+{
+    float *x;
+    float *z;
+    const float *input_h;
+    const float *input_v;
+    std::size_t count;
+};
+
+void integrate_movement(const MovementBatch &batch, float distance);
+
+// Reference implementation, one entry at a time.
+void integrate_movement_scalar(const MovementBatch &batch, float distance);
+
+// "avx2", "sse2" or "scalar": the kernel integrate_movement() uses.
+const char *movement_kernel_name();
+
+struct MovementKernel
+{
+    void (*integrate)(const MovementBatch &, float);
+    const char *name;
+};
+
+// Every kernel built in that this CPU can run, scalar first, so they can be checked against it.
+std::vector<MovementKernel> available_movement_kernels();
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+// 다중 생산자 단일 소비자 큐
+// Bounded lock-free queue: any thread may push, one thread at a time drains. Each cell carries a
+// sequence number that tells producers when it is free and the consumer when it is filled, so
+// pushing is one compare-and-swap and never allocates. When the queue is full try_push() fails
+// rather than waiting.
+template <class T, std::size_t Capacity>
+class MpscQueue
+{
+    static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0, "capacity must be a power of two");
+
+public:
+    MpscQueue()
+    {
+        for (std::size_t i = 0; i < Capacity; ++i)
+        {
+            cells_[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+    MpscQueue(const MpscQueue &) = delete;
+    MpscQueue &operator=(const MpscQueue &) = delete;
+
+    // Returns false, leaving `value` alone, when the queue is full.
+    bool try_push(T &&value)
+    {
+        std::size_t position = tail_.load(std::memory_order_relaxed);
+        while (true)
+        {
+            Cell &cell = cells_[position & (Capacity - 1)];
+            const std::size_t sequence = cell.sequence.load(std::memory_order_acquire);
+            const auto lag = static_cast<std::intptr_t>(sequence) - static_cast<std::intptr_t>(position);
+            if (lag == 0)
+            {
+                // The cell is free; claim it before another producer does.
+                if (tail_.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+                {
+                    cell.value = std::move(value);
+                    cell.sequence.store(position + 1, std::memory_order_release);
+                    return true;
+                }
+            }
+            else if (lag < 0)
+            {
+                return false; // the consumer has not emptied this cell yet
+            }
+            else
+            {
+                position = tail_.load(std::memory_order_relaxed); // another producer took it
+            }
+        }
+    }
+
+    // Consumer only. Calls `f` with every value pushed so far, in the order they were claimed,
+    // and returns how many there were. Stops at the first cell whose producer is still writing.
+    template <class F>
+    std::size_t drain(F &&f)
+    {
+        std::size_t count = 0;
+        while (true)
+        {
+            Cell &cell = cells_[head_ & (Capacity - 1)];
+            if (cell.sequence.load(std::memory_order_acquire) != head_ + 1)
+            {
+                return count;
+            }
+            T value = std::move(cell.value);
+            cell.value = T{};
+            cell.sequence.store(head_ + Capacity, std::memory_order_release);
+            ++head_;
+            ++count;
+            f(value);
+        }
+    }
+
+private:
+    struct Cell
+    {
+        std::atomic<std::size_t> sequence;
+        T value;
+    };
+
+    std::array<Cell, Capacity> cells_;
+    alignas(64) std::atomic<std::size_t> tail_{0}; // next position producers claim
+    alignas(64) std::size_t head_ = 0;             // next position the consumer reads
+};
@@ -1,24 +1,17 @@
 #pragma once
 
+#include <cstdint>
 #include <string>
-
-// 3D vector
-struct vec3 {
-    float x, y, z;
-};
+#include "EntityId.h"
 
 // 클라이언트 정보를 담는 구조체
+// Owned by the lobby strand. A room copies what it needs into its RoomMember on entry (see
+// Room.h) and never reads the record, so nothing here is shared with a room strand.
 struct Player
 {
-    std::string id;
+    EntityId id;
     std::string nickname;
     int room_id = -1;      // -1 : 방 없음.
-    bool is_ready = false; // 준비 상태.
-    vec3 position = {0, 0, 0};
-
-    // Animation and input state
-    float anim_forward = 0.0f;
-    float anim_strafe = 0.0f;
-    float input_h = 0.0f;
-    float input_v = 0.0f;
+    std::uint64_t udp_token = 0; // UDP 채널 바인딩 토큰.
+    // Ready state, position, input and animation are room state and live in the room.
 };
@@ -0,0 +1,212 @@
+#include "PlayerInputDecoder.h"
+#include <charconv>
+#include <cstdint>
+
+namespace
+{
+    class Scanner
+    {
+    public:
+        explicit Scanner(std::string_view text) : text_(text) {}
+
+        void skip_whitespace()
+        {
+            while (pos_ < text_.size() && (text_[pos_] == ' ' || text_[pos_] == '\t' || text_[pos_] == '\n' || text_[pos_] == '\r'))
+            {
+                ++pos_;
+            }
+        }
+
+        bool consume(char c)
+        {
+            skip_whitespace();
+            if (pos_ < text_.size() && text_[pos_] == c)
+            {
+                ++pos_;
+                return true;
+            }
+            return false;
+        }
+
+        bool at_end()
+        {
+            skip_whitespace();
+            return pos_ == text_.size();
+        }
+
+        // A string without escapes; anything escaped is left to the general parser.
+        bool string(std::string_view &value)
+        {
+            if (!consume('"'))
+            {
+                return false;
+            }
+            const std::size_t start = pos_;
+            while (pos_ < text_.size())
+            {
+                const char c = text_[pos_];
+                if (c == '"')
+                {
+                    value = text_.substr(start, pos_ - start);
+                    ++pos_;
+                    return true;
+                }
+                if (c == '\\' || static_cast<unsigned char>(c) < 0x20 || static_cast<unsigned char>(c) >= 0x80)
+                {
+                    return false;
+                }
+                ++pos_;
+            }
+            return false;
+        }
+
+        // A JSON number, converted to float the way json::parse + get<float> does: integers
+        // through int64, everything else through double.
+        bool number(float &value)
+        {
+            skip_whitespace();
+            const std::size_t start = pos_;
+            bool integral = true;
+            if (peek() == '-')
+            {
+                ++pos_;
+            }
+            if (peek() == '0')
+            {
+                ++pos_;
+            }
+            else if (!digits())
+            {
+                return false;
+            }
+            if (peek() == '.')
+            {
+                ++pos_;
+                integral = false;
+                if (!digits())
+                {
+                    return false;
+                }
+            }
+            if (peek() == 'e' || peek() == 'E')
+            {
+                ++pos_;
+                integral = false;
+                if (peek() == '+' || peek() == '-')
+                {
+                    ++pos_;
+                }
+                if (!digits())
+                {
+                    return false;
+                }
+            }
+
+            const char *first = text_.data() + start;
+            const char *last = text_.data() + pos_;
+            if (integral)
+            {
+                std::int64_t parsed = 0;
+                const auto result = std::from_chars(first, last, parsed);
+                value = static_cast<float>(parsed);
+                return result.ec == std::errc() && result.ptr == last;
+            }
+            double parsed = 0;
+            const auto result = std::from_chars(first, last, parsed);
+            value = static_cast<float>(parsed);
+            return result.ec == std::errc() && result.ptr == last;
+        }
+
+    private:
+        char peek() const { return pos_ < text_.size() ? text_[pos_] : '\0'; }
+
+        bool digits()
+        {
+            const std::size_t start = pos_;
+            while (pos_ < text_.size() && text_[pos_] >= '0' && text_[pos_] <= '9')
+            {
+                ++pos_;
+            }
+            return pos_ != start;
+        }
+
+        std::string_view text_;
+        std::size_t pos_ = 0;
+    };
+
+    // {"h": .., "v": .., "anim_forward": .., "anim_strafe": ..} in any order, each exactly once.
+    bool decode_input(Scanner &scanner, InputInfo &input)
+    {
+        if (!scanner.consume('{'))
+        {
+            return false;
+        }
+        unsigned seen = 0;
+        do
+        {
+            std::string_view key;
+            if (!scanner.string(key) || !scanner.consume(':'))
+            {
+                return false;
+            }
+            float *target = nullptr;
+            unsigned bit = 0;
+            if (key == "h")
+                target = &input.h, bit = 1;
+            else if (key == "v")
+                target = &input.v, bit = 2;
+            else if (key == "anim_forward")
+                target = &input.anim_forward, bit = 4;
+            else if (key == "anim_strafe")
+                target = &input.anim_strafe, bit = 8;
+            if (!target || (seen & bit) || !scanner.number(*target))
+            {
+                return false;
+            }
+            seen |= bit;
+        } while (scanner.consume(','));
+        return seen == 15 && scanner.consume('}');
+    }
+}
+
+bool decode_player_input(std::string_view text, bool require_type, PlayerInputRequest &request)
+{
+    Scanner scanner(text);
+    if (!scanner.consume('{'))
+    {
+        return false;
+    }
+    bool has_type = false;
+    bool has_input = false;
+    do
+    {
+        std::string_view key;
+        if (!scanner.string(key) || !scanner.consume(':'))
+        {
+            return false;
+        }
+        if (key == "type" && !has_type)
+        {
+            std::string_view type;
+            if (!scanner.string(type) || type != "player_input")
+            {
+                return false;
+            }
+            has_type = true;
+        }
+        else if (key == "input" && !has_input)
+        {
+            if (!decode_input(scanner, request.input))
+            {
+                return false;
+            }
+            has_input = true;
+        }
+        else
+        {
+            return false;
+        }
+    } while (scanner.consume(','));
+
+    return has_input && (has_type || !require_type) && scanner.consume('}') && scanner.at_end();
+}
@@ -0,0 +1,17 @@
+#pragma once
+
+#include <string_view>
+#include "Schema.h"
+
+// player_input 전용 고속 디코더
+// Decodes a JSON player_input request in one pass, without building a json DOM.
+//
+// Only the plain shape clients send is recognized: an object holding "input" with the four
+// numeric fields h, v, anim_forward and anim_strafe, and optionally "type": "player_input".
+// Anything else (other keys, escaped strings, non-numeric values, a different type) makes it
+// return false, and the caller falls back to json::parse, which then accepts or rejects the
+// message exactly as before. Values are rounded the same way json::parse + get<float> does.
+//
+// `require_type` is set for newline framing, where "type" is the only way to tell the message
+// apart; with binary framing the frame header already said it is a player_input.
+bool decode_player_input(std::string_view text, bool require_type, PlayerInputRequest &request);
@@ -0,0 +1,130 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <memory>
+#include "Player.h"
+
+// 플레이어 핸들
+// Names a slot in one shard's PlayerRegistry. The generation changes every time the slot is
+// freed, so a handle kept past its player's disconnect resolves to nothing instead of to whoever
+// got the slot next. The null handle names no player.
+struct PlayerHandle
+{
+    std::uint32_t index = 0;      // registry tag in the top bits, slot below
+    std::uint32_t generation = 0; // 0: null handle
+
+    explicit operator bool() const { return generation != 0; }
+    friend bool operator==(PlayerHandle a, PlayerHandle b) { return a.index == b.index && a.generation == b.generation; }
+    friend bool operator!=(PlayerHandle a, PlayerHandle b) { return !(a == b); }
+};
+
+// 플레이어 레지스트리
+// Every connected player of a shard, in fixed-size chunks of slots that never move once
+// allocated, so a Player* stays valid while other slots are added and freed. Sessions keep
+// PlayerHandles; resolving one is an array index and a generation compare.
+//
+// The registry and its records belong to the lobby strand; rooms keep their own copies (see
+// RoomMember in Room.h).
+class PlayerRegistry
+{
+public:
+    static constexpr std::size_t kMaxPlayers = std::size_t(1) << 18; // per shard
+    static constexpr std::uint32_t kMaxTags = 256;                   // and so shards
+
+    // `tag` tells this registry's handles from other shards'.
+    explicit PlayerRegistry(std::uint32_t tag = 0) : tag_(tag << kSlotBits) {}
+
+    // Returns the new player's handle, or a null handle when the registry is full.
+    PlayerHandle insert(Player player)
+    {
+        std::uint32_t slot = free_head_;
+        if (slot != kNoSlot)
+        {
+            free_head_ = at(slot).next_free;
+        }
+        else if (slot_count_ < kMaxPlayers)
+        {
+            slot = slot_count_++;
+            auto &chunk = chunks_[slot >> kChunkBits];
+            if (!chunk)
+            {
+                chunk = std::make_unique<Slot[]>(kChunkSize);
+            }
+        }
+        else
+        {
+            return {};
+        }
+
+        Slot &entry = at(slot);
+        entry.live = true;
+        entry.player = std::move(player);
+        ++size_;
+        return {tag_ | slot, entry.generation};
+    }
+
+    // Frees the slot of `handle`. Stale and null handles are ignored.
+    void erase(PlayerHandle handle)
+    {
+        Slot *entry = find(handle);
+        if (!entry)
+        {
+            return;
+        }
+        entry->live = false;
+        entry->player = Player{};
+        if (++entry->generation == 0)
+        {
+            entry->generation = 1;
+        }
+        entry->next_free = free_head_;
+        free_head_ = handle.index & kSlotMask;
+        --size_;
+    }
+
+    // The player `handle` names, or null if it was freed or belongs to another registry.
+    Player *get(PlayerHandle handle)
+    {
+        Slot *entry = find(handle);
+        return entry ? &entry->player : nullptr;
+    }
+
+    std::size_t size() const { return size_; }
+
+private:
+    static constexpr int kSlotBits = 24;
+    static constexpr std::uint32_t kSlotMask = (1u << kSlotBits) - 1;
+    static constexpr int kChunkBits = 8;
+    static constexpr std::size_t kChunkSize = std::size_t(1) << kChunkBits;
+    static constexpr std::uint32_t kNoSlot = UINT32_MAX;
+    static_assert(kMaxPlayers <= (std::size_t(1) << kSlotBits), "slot numbers must fit below the tag");
+    static_assert(kMaxTags <= (std::uint64_t(1) << (32 - kSlotBits)), "tags must fit above the slot number");
+
+    struct Slot
+    {
+        std::uint32_t generation = 1; // of the current occupant, or of the next one while free
+        std::uint32_t next_free = kNoSlot;
+        bool live = false;
+        Player player;
+    };
+
+    Slot &at(std::uint32_t slot) { return chunks_[slot >> kChunkBits][slot & (kChunkSize - 1)]; }
+
+    Slot *find(PlayerHandle handle)
+    {
+        // Only insert() makes handles with this tag, so the slot exists.
+        if (!handle || (handle.index & ~kSlotMask) != tag_)
+        {
+            return nullptr;
+        }
+        Slot &entry = at(handle.index & kSlotMask);
+        return entry.live && entry.generation == handle.generation ? &entry : nullptr;
+    }
+
+    const std::uint32_t tag_;
+    std::array<std::unique_ptr<Slot[]>, kMaxPlayers / kChunkSize> chunks_;
+    std::uint32_t slot_count_ = 0; // slots ever handed out; all below it are allocated
+    std::uint32_t free_head_ = kNoSlot;
+    std::size_t size_ = 0;
+};
@@ -0,0 +1,91 @@
+#include "Protocol.h"
+
+namespace
+{
+    struct MessageTypeName
+    {
+        MessageType type;
+        std::string_view name;
+    };
+
+    constexpr MessageTypeName kMessageTypeNames[] = {
+        {MessageType::CreateRoom, "create_room"},
+        {MessageType::FindRooms, "find_rooms"},
+        {MessageType::JoinRoom, "join_room"},
+        {MessageType::ChatMessage, "chat_message"},
+        {MessageType::LeaveRoom, "leave_room"},
+        {MessageType::ToggleReady, "toggle_ready"},
+        {MessageType::StartGame, "start_game"},
+        {MessageType::SetNickname, "set_nickname"},
+        {MessageType::PlayerInput, "player_input"},
+        {MessageType::UdpHello, "udp_hello"},
+        {MessageType::SnapshotAck, "snapshot_ack"},
+        {MessageType::UdpConfirm, "udp_confirm"},
+        {MessageType::AssignId, "assign_id"},
+        {MessageType::UpdateRoomInfo, "update_room_info"},
+        {MessageType::FindRoomsResponse, "find_rooms_response"},
+        {MessageType::ChatBroadcast, "chat_broadcast"},
+        {MessageType::LeaveRoomSuccess, "leave_room_success"},
+        {MessageType::GameStateUpdate, "game_state_update"},
+    };
+
+    // Perfect hash from "type" strings to message ids: FNV-1a with a seed picked so that no two
+    // names share a slot. A new name that collides fails the static_assert below; try another seed.
+    constexpr std::uint32_t kMessageTypeHashSeed = 19;
+    constexpr std::size_t kMessageTypeSlotCount = 64;
+
+    constexpr std::uint32_t message_type_hash(std::string_view name)
+    {
+        std::uint32_t hash = kMessageTypeHashSeed;
+        for (const char c : name)
+        {
+            hash = (hash ^ static_cast<std::uint8_t>(c)) * 16777619u;
+        }
+        return hash;
+    }
+
+    using MessageTypeSlots = std::array<MessageTypeName, kMessageTypeSlotCount>;
+
+    constexpr MessageTypeSlots make_message_type_slots()
+    {
+        MessageTypeSlots slots{};
+        for (const auto &entry : kMessageTypeNames)
+        {
+            slots[message_type_hash(entry.name) & (kMessageTypeSlotCount - 1)] = entry;
+        }
+        return slots;
+    }
+
+    constexpr bool message_type_slots_unique(const MessageTypeSlots &slots)
+    {
+        for (const auto &entry : kMessageTypeNames)
+        {
+            if (slots[message_type_hash(entry.name) & (kMessageTypeSlotCount - 1)].type != entry.type)
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    constexpr MessageTypeSlots kMessageTypeSlots = make_message_type_slots();
+    static_assert(message_type_slots_unique(kMessageTypeSlots), "message type names collide; change kMessageTypeHashSeed");
+}
+
+const char *to_string(MessageType type)
+{
+    for (const auto &entry : kMessageTypeNames)
+    {
+        if (entry.type == type)
+        {
+            return entry.name.data();
+        }
+    }
+    return "";
+}
+
+MessageType message_type_from_string(std::string_view name)
+{
+    const MessageTypeName &entry = kMessageTypeSlots[message_type_hash(name) & (kMessageTypeSlotCount - 1)];
+    return entry.name == name ? entry.type : MessageType::Unknown;
+}
@@ -0,0 +1,174 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <string_view>
+
+// 서버와 클라이언트가 주고받는 메시지 종류와 프레이밍 정의
+// Message types and wire framing shared by every transport.
+
+// Numeric message ids. Values are part of the wire format, never reorder them.
+enum class MessageType : std::uint16_t
+{
+    Unknown = 0,
+
+    // Client -> Server
+    CreateRoom = 1,
+    FindRooms = 2,
+    JoinRoom = 3,
+    ChatMessage = 4,
+    LeaveRoom = 5,
+    ToggleReady = 6,
+    StartGame = 7,
+    SetNickname = 8,
+    PlayerInput = 9,
+    UdpHello = 10, // datagram asking to bind the sender's UDP endpoint; answered with a challenge
+    SnapshotAck = 11, // newest game_state_update received; deltas are encoded against it
+    UdpConfirm = 12, // echoes a udp_hello challenge over TCP, binding the endpoint it was sent to
+
+    // Server -> Client
+    AssignId = 100,
+    UpdateRoomInfo = 101,
+    FindRoomsResponse = 102,
+    ChatBroadcast = 103,
+    LeaveRoomSuccess = 104,
+    GameStateUpdate = 105,
+};
+
+// Client -> Server ids are dense from 1, so a request's id indexes a table directly.
+constexpr std::size_t kRequestTypeCount = static_cast<std::size_t>(MessageType::UdpConfirm) + 1;
+
+// The JSON "type" string for a message id, and back. Unknown names map to MessageType::Unknown.
+const char *to_string(MessageType type);
+MessageType message_type_from_string(std::string_view name);
+
+// How a session delimits messages on its TCP stream.
+enum class Framing : std::uint8_t
+{
+    Newline, // JSON text terminated by '\n' (Unity NetworkManager)
+    Binary,  // [u32 payload length][u16 message type] header, little-endian, then payload
+};
+
+// How message payloads are serialized, on TCP and UDP alike.
+enum class Encoding : std::uint8_t
+{
+    Json,   // JSON object with a "type" field
+    Schema, // compact binary encoding generated from Schema.h; the type comes from the frame
+};
+
+// A client switches to binary framing by sending one of these lines as its very first message,
+// optionally followed by space-separated capabilities. The server answers with the same hello and
+// the capabilities it accepted (still newline framed); every byte after it, in both directions,
+// uses binary frames. kSchemaEncodingHello also switches the payloads to Encoding::Schema.
+constexpr std::string_view kBinaryFramingHello = "GF-BINARY/1";
+constexpr std::string_view kSchemaEncodingHello = "GF-SCHEMA/1";
+
+// Set in a binary frame's message type when its payload is compressed (see FrameCompression.h).
+constexpr std::uint16_t kCompressedFrameFlag = 0x8000;
+
+constexpr std::size_t kFrameHeaderSize = 6;
+constexpr std::uint32_t kMaxFrameSize = 1 << 20; // 1 MiB
+
+using FrameHeader = std::array<std::uint8_t, kFrameHeaderSize>;
+
+inline FrameHeader encode_frame_header(MessageType type, std::uint32_t length, bool compressed = false)
+{
+    const auto t = static_cast<std::uint16_t>(static_cast<std::uint16_t>(type) | (compressed ? kCompressedFrameFlag : 0));
+    return {static_cast<std::uint8_t>(length),
+            static_cast<std::uint8_t>(length >> 8),
+            static_cast<std::uint8_t>(length >> 16),
+            static_cast<std::uint8_t>(length >> 24),
+            static_cast<std::uint8_t>(t),
+            static_cast<std::uint8_t>(t >> 8)};
+}
+
+inline void decode_frame_header(const std::uint8_t *data, std::uint32_t &length, MessageType &type, bool &compressed)
+{
+    length = static_cast<std::uint32_t>(data[0]) |
+             static_cast<std::uint32_t>(data[1]) << 8 |
+             static_cast<std::uint32_t>(data[2]) << 16 |
+             static_cast<std::uint32_t>(data[3]) << 24;
+    const auto t = static_cast<std::uint16_t>(data[4] | data[5] << 8);
+    type = static_cast<MessageType>(t & ~kCompressedFrameFlag);
+    compressed = (t & kCompressedFrameFlag) != 0;
+}
+
+// UDP 전송 채널
+// Delivery guarantees a UDP message can ask for.
+enum class Channel : std::uint8_t
+{
+    Unreliable = 0,          // may be lost, duplicated or reordered
+    UnreliableSequenced = 1, // may be lost; anything older than the newest delivered is dropped
+    ReliableUnordered = 2,   // resent until acked, delivered once, in arrival order
+    ReliableOrdered = 3,     // resent until acked, delivered once, in send order
+};
+
+constexpr bool is_reliable(Channel channel)
+{
+    return channel == Channel::ReliableUnordered || channel == Channel::ReliableOrdered;
+}
+
+// UDP datagrams carry one message each, behind a packet header:
+// [u16 sequence][u16 ack][u32 ack bits][u8 channel][u16 channel sequence][u16 message type]
+// `sequence` numbers packets per peer and direction. `ack` is the newest sequence received from
+// the other side, and bit i of `ack bits` acknowledges ack - 1 - i. `channel sequence` numbers
+// messages within one channel. A packet with MessageType::Unknown and no payload only carries acks.
+// Client -> Server datagrams are prefixed with the session's u64 udp token.
+struct PacketHeader
+{
+    std::uint16_t sequence = 0;
+    std::uint16_t ack = 0;
+    std::uint32_t ack_bits = 0;
+    Channel channel = Channel::Unreliable;
+    std::uint16_t channel_sequence = 0;
+    MessageType type = MessageType::Unknown;
+};
+
+constexpr std::size_t kUdpTokenSize = 8;
+constexpr std::size_t kPacketHeaderSize = 13;
+constexpr std::size_t kMaxDatagramSize = 65507;
+
+using PacketHeaderBytes = std::array<std::uint8_t, kPacketHeaderSize>;
+
+inline PacketHeaderBytes encode_packet_header(const PacketHeader &header)
+{
+    const auto t = static_cast<std::uint16_t>(header.type);
+    return {static_cast<std::uint8_t>(header.sequence),
+            static_cast<std::uint8_t>(header.sequence >> 8),
+            static_cast<std::uint8_t>(header.ack),
+            static_cast<std::uint8_t>(header.ack >> 8),
+            static_cast<std::uint8_t>(header.ack_bits),
+            static_cast<std::uint8_t>(header.ack_bits >> 8),
+            static_cast<std::uint8_t>(header.ack_bits >> 16),
+            static_cast<std::uint8_t>(header.ack_bits >> 24),
+            static_cast<std::uint8_t>(header.channel),
+            static_cast<std::uint8_t>(header.channel_sequence),
+            static_cast<std::uint8_t>(header.channel_sequence >> 8),
+            static_cast<std::uint8_t>(t),
+            static_cast<std::uint8_t>(t >> 8)};
+}
+
+// Returns false if the channel is not one of the known values.
+inline bool decode_packet_header(const std::uint8_t *data, PacketHeader &header)
+{
+    header.sequence = static_cast<std::uint16_t>(data[0] | data[1] << 8);
+    header.ack = static_cast<std::uint16_t>(data[2] | data[3] << 8);
+    header.ack_bits = static_cast<std::uint32_t>(data[4]) |
+                      static_cast<std::uint32_t>(data[5]) << 8 |
+                      static_cast<std::uint32_t>(data[6]) << 16 |
+                      static_cast<std::uint32_t>(data[7]) << 24;
+    if (data[8] > static_cast<std::uint8_t>(Channel::ReliableOrdered))
+    {
+        return false;
+    }
+    header.channel = static_cast<Channel>(data[8]);
+    header.channel_sequence = static_cast<std::uint16_t>(data[9] | data[10] << 8);
+    header.type = static_cast<MessageType>(static_cast<std::uint16_t>(data[11] | data[12] << 8));
+    return true;
+}
+
+// True if sequence number `a` is newer than `b`, allowing for wrap-around.
+constexpr bool sequence_greater_than(std::uint16_t a, std::uint16_t b)
+{
+    return ((a > b) && (a - b <= 32768)) || ((a < b) && (b - a > 32768));
+}
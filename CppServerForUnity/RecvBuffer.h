@@ -0,0 +1,61 @@
+#pragma once
+
+#include <cstring>
+#include <string_view>
+#include <vector>
+#include <asio/ts/buffer.hpp>
+
+// 세션별 수신 버퍼
+// Contiguous receive buffer. Sockets read into the free space at the tail and complete frames
+// are handed out as string_views over the unread region, so nothing is copied per message.
+// When every byte has been consumed the read/write positions wrap back to the start; a partial
+// frame left at the end is slid to the front only when the tail runs out of room.
+class RecvBuffer
+{
+public:
+    explicit RecvBuffer(std::size_t capacity = 16 * 1024) : storage_(capacity) {}
+
+    // Free space of at least `min_size` bytes for the next read.
+    asio::mutable_buffer prepare(std::size_t min_size)
+    {
+        if (storage_.size() - end_ < min_size)
+        {
+            compact();
+            if (storage_.size() - end_ < min_size)
+            {
+                storage_.resize(end_ + min_size);
+            }
+        }
+        return asio::buffer(storage_.data() + end_, storage_.size() - end_);
+    }
+
+    void commit(std::size_t length) { end_ += length; }
+
+    void consume(std::size_t length)
+    {
+        begin_ += length;
+        if (begin_ == end_)
+        {
+            begin_ = end_ = 0;
+        }
+    }
+
+    std::string_view data() const { return {storage_.data() + begin_, end_ - begin_}; }
+    std::size_t size() const { return end_ - begin_; }
+
+private:
+    void compact()
+    {
+        if (begin_ == 0)
+        {
+            return;
+        }
+        std::memmove(storage_.data(), storage_.data() + begin_, end_ - begin_);
+        end_ -= begin_;
+        begin_ = 0;
+    }
+
+    std::vector<char> storage_;
+    std::size_t begin_ = 0; // 아직 처리하지 않은 첫 바이트
+    std::size_t end_ = 0;   // 수신된 마지막 바이트의 다음 위치
+};
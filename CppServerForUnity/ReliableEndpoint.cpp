@@ -0,0 +1,252 @@
+#include "ReliableEndpoint.h"
+
+namespace
+{
+    constexpr std::chrono::microseconds kInitialTimeout = std::chrono::milliseconds(200);
+    constexpr std::chrono::microseconds kMinTimeout = std::chrono::milliseconds(30);
+    constexpr std::chrono::microseconds kMaxTimeout = std::chrono::milliseconds(1000);
+}
+
+PacketHeader ReliableEndpoint::prepare(Channel channel, MessageType type, SharedMessage payload, Clock::time_point now)
+{
+    const std::uint16_t channel_sequence = next_channel_sequence_[static_cast<std::size_t>(channel)]++;
+    PacketHeader header = stamp(channel, channel_sequence, type);
+
+    std::uint64_t message_id = 0;
+    if (is_reliable(channel))
+    {
+        message_id = next_message_id_++;
+        pending_.emplace(message_id, PendingMessage{channel, channel_sequence, type, std::move(payload), now, retransmission_timeout(), 0});
+        if (pending_.size() > kMaxPending)
+        {
+            failed_ = true;
+        }
+    }
+    record_sent(header.sequence, message_id, false, now);
+    return header;
+}
+
+void ReliableEndpoint::receive(const PacketHeader &header, std::string_view payload, Clock::time_point now, const DeliverFn &deliver)
+{
+    process_acks(header.ack, header.ack_bits, now);
+
+    // Track which packets we have seen, for the acks we send back.
+    if (!received_any_)
+    {
+        received_any_ = true;
+        remote_sequence_ = header.sequence;
+        received_bits_ = 0;
+    }
+    else if (sequence_greater_than(header.sequence, remote_sequence_))
+    {
+        const std::uint16_t shift = static_cast<std::uint16_t>(header.sequence - remote_sequence_);
+        const std::uint64_t bits = shift > 32 ? 0 : (static_cast<std::uint64_t>(received_bits_) << shift) | (std::uint64_t{1} << (shift - 1));
+        received_bits_ = static_cast<std::uint32_t>(bits);
+        remote_sequence_ = header.sequence;
+    }
+    else
+    {
+        const std::uint16_t distance = static_cast<std::uint16_t>(remote_sequence_ - header.sequence);
+        if (distance >= 1 && distance <= 32)
+        {
+            received_bits_ |= std::uint32_t{1} << (distance - 1);
+        }
+    }
+
+    if (header.type == MessageType::Unknown)
+    {
+        return; // ack-only packet; acking it back would ping-pong forever
+    }
+    // Unreliable packets are acked whenever something else goes out; reliable ones are owed a prompt ack.
+    if (is_reliable(header.channel))
+    {
+        ack_owed_ = true;
+    }
+
+    const std::uint16_t cs = header.channel_sequence;
+    switch (header.channel)
+    {
+    case Channel::Unreliable:
+        deliver(header.type, payload);
+        break;
+
+    case Channel::UnreliableSequenced:
+        if (!sequenced_received_any_ || sequence_greater_than(cs, last_sequenced_))
+        {
+            sequenced_received_any_ = true;
+            last_sequenced_ = cs;
+            deliver(header.type, payload);
+        }
+        break;
+
+    case Channel::ReliableUnordered:
+    {
+        auto &slot = unordered_received_[cs % kReceiveWindow];
+        if (slot != cs)
+        {
+            slot = cs;
+            deliver(header.type, payload);
+        }
+        break;
+    }
+
+    case Channel::ReliableOrdered:
+        if (cs == next_ordered_)
+        {
+            deliver(header.type, payload);
+            ++next_ordered_;
+            // Release whatever was waiting on this message.
+            for (auto *buffered = &ordered_buffer_[next_ordered_ % kReceiveWindow];
+                 buffered->valid && buffered->channel_sequence == next_ordered_;
+                 buffered = &ordered_buffer_[next_ordered_ % kReceiveWindow])
+            {
+                buffered->valid = false;
+                deliver(buffered->type, buffered->payload);
+                std::string().swap(buffered->payload);
+                ++next_ordered_;
+            }
+        }
+        else if (sequence_greater_than(cs, next_ordered_) && static_cast<std::uint16_t>(cs - next_ordered_) < kReceiveWindow)
+        {
+            auto &buffered = ordered_buffer_[cs % kReceiveWindow];
+            if (!buffered.valid)
+            {
+                buffered.valid = true;
+                buffered.channel_sequence = cs;
+                buffered.type = header.type;
+                buffered.payload.assign(payload.data(), payload.size());
+            }
+        }
+        // Older than next_ordered_: a duplicate of something already delivered.
+        // Too far ahead: dropped, the sender resends it once the window catches up.
+        break;
+    }
+}
+
+void ReliableEndpoint::update(Clock::time_point now, const SendFn &send)
+{
+    if (failed_)
+    {
+        return;
+    }
+
+    for (auto &[id, message] : pending_)
+    {
+        if (now - message.last_sent < message.timeout)
+        {
+            continue;
+        }
+        if (message.resends == kMaxResends)
+        {
+            failed_ = true;
+            return;
+        }
+
+        const PacketHeader header = stamp(message.channel, message.channel_sequence, message.type);
+        record_sent(header.sequence, id, true, now);
+        message.last_sent = now;
+        message.timeout = std::min(message.timeout * 2, kMaxTimeout);
+        ++message.resends;
+        send(header, *message.payload);
+    }
+
+    if (ack_owed_)
+    {
+        static const std::string empty;
+        const PacketHeader header = stamp(Channel::Unreliable, 0, MessageType::Unknown);
+        record_sent(header.sequence, 0, false, now);
+        send(header, empty);
+    }
+}
+
+std::vector<std::pair<MessageType, SharedMessage>> ReliableEndpoint::take_pending()
+{
+    std::vector<std::pair<MessageType, SharedMessage>> messages;
+    messages.reserve(pending_.size());
+    for (auto &[id, message] : pending_)
+    {
+        messages.emplace_back(message.type, std::move(message.payload));
+    }
+    pending_.clear();
+    return messages;
+}
+
+// Every packet carries the latest acks, so sending anything settles what we owe.
+PacketHeader ReliableEndpoint::stamp(Channel channel, std::uint16_t channel_sequence, MessageType type)
+{
+    PacketHeader header;
+    header.sequence = next_sequence_++;
+    header.ack = remote_sequence_;
+    header.ack_bits = received_bits_;
+    header.channel = channel;
+    header.channel_sequence = channel_sequence;
+    header.type = type;
+    ack_owed_ = false;
+    return header;
+}
+
+void ReliableEndpoint::record_sent(std::uint16_t sequence, std::uint64_t message_id, bool retransmission, Clock::time_point now)
+{
+    auto &slot = sent_packets_[sequence % kSentPacketWindow];
+    slot.sequence = sequence;
+    slot.valid = true;
+    slot.retransmission = retransmission;
+    slot.message_id = message_id;
+    slot.sent_at = now;
+}
+
+void ReliableEndpoint::process_acks(std::uint16_t ack, std::uint32_t ack_bits, Clock::time_point now)
+{
+    acknowledge(ack, now);
+    for (std::uint16_t i = 0; i < 32; ++i)
+    {
+        if (ack_bits & (std::uint32_t{1} << i))
+        {
+            acknowledge(static_cast<std::uint16_t>(ack - 1 - i), now);
+        }
+    }
+}
+
+void ReliableEndpoint::acknowledge(std::uint16_t sequence, Clock::time_point now)
+{
+    auto &slot = sent_packets_[sequence % kSentPacketWindow];
+    if (!slot.valid || slot.sequence != sequence)
+    {
+        return;
+    }
+    slot.valid = false;
+
+    // Only reliable packets are acked promptly enough to time. Karn's rule: a retransmitted
+    // packet's ack cannot tell which copy it answers.
+    if (slot.message_id != 0 && !slot.retransmission)
+    {
+        add_rtt_sample(std::chrono::duration_cast<std::chrono::microseconds>(now - slot.sent_at));
+    }
+    if (slot.message_id != 0)
+    {
+        pending_.erase(slot.message_id);
+    }
+}
+
+void ReliableEndpoint::add_rtt_sample(std::chrono::microseconds sample)
+{
+    if (!has_rtt_)
+    {
+        has_rtt_ = true;
+        srtt_ = sample;
+        rttvar_ = sample / 2;
+        return;
+    }
+    const auto error = srtt_ > sample ? srtt_ - sample : sample - srtt_;
+    rttvar_ = (rttvar_ * 3 + error) / 4;
+    srtt_ = (srtt_ * 7 + sample) / 8;
+}
+
+std::chrono::microseconds ReliableEndpoint::retransmission_timeout() const
+{
+    if (!has_rtt_)
+    {
+        return kInitialTimeout;
+    }
+    return std::clamp(srtt_ + rttvar_ * 4, kMinTimeout, kMaxTimeout);
+}
@@ -0,0 +1,113 @@
+#pragma once
+
+#include "stdafx.h"
+#include "Message.h"
+#include "Protocol.h"
+#include <chrono>
+
+// UDP 피어별 신뢰성 계층
+// Per-peer reliability over datagrams: packet sequence numbers, ack + ack bitfield on every packet,
+// resend of reliable messages on an RTT-derived timeout, and per-channel delivery rules.
+// It does no I/O itself; UdpChannel feeds it packets and sends what it returns.
+//
+// A peer that stops acking is given up on rather than buffered for forever: once a reliable
+// message has been resent kMaxResends times unacked, or kMaxPending of them are waiting, the
+// endpoint fails and its unacked messages can be taken back to deliver some other way.
+class ReliableEndpoint
+{
+public:
+    using Clock = std::chrono::steady_clock;
+    using SendFn = std::function<void(const PacketHeader &, const std::string &)>;
+    using DeliverFn = std::function<void(MessageType, std::string_view)>;
+
+    static constexpr int kMaxResends = 8;            // about 6 s at the longest timeout
+    static constexpr std::size_t kMaxPending = 256;  // reliable messages waiting for an ack
+
+    // Stamps a new outgoing message. Reliable messages are kept until one of their packets is acked.
+    PacketHeader prepare(Channel channel, MessageType type, SharedMessage payload, Clock::time_point now);
+
+    // Processes an incoming packet and delivers every message it makes available.
+    void receive(const PacketHeader &header, std::string_view payload, Clock::time_point now, const DeliverFn &deliver);
+
+    // Resends reliable messages whose timeout has expired, and sends a bare ack if one is owed.
+    void update(Clock::time_point now, const SendFn &send);
+
+    // True once the peer is given up on. A failed endpoint sends nothing more.
+    bool failed() const { return failed_; }
+
+    // Removes and returns the reliable messages not yet acked, in send order.
+    std::vector<std::pair<MessageType, SharedMessage>> take_pending();
+
+    std::chrono::microseconds rtt() const { return srtt_; }
+
+private:
+    struct SentPacket
+    {
+        std::uint16_t sequence = 0;
+        bool valid = false;
+        bool retransmission = false;
+        std::uint64_t message_id = 0; // 0: no reliable message in this packet
+        Clock::time_point sent_at;
+    };
+
+    struct PendingMessage
+    {
+        Channel channel;
+        std::uint16_t channel_sequence;
+        MessageType type;
+        SharedMessage payload;
+        Clock::time_point last_sent;
+        std::chrono::microseconds timeout;
+        int resends = 0;
+    };
+
+    struct BufferedMessage
+    {
+        bool valid = false;
+        std::uint16_t channel_sequence = 0;
+        MessageType type = MessageType::Unknown;
+        std::string payload;
+    };
+
+    static constexpr std::size_t kSentPacketWindow = 256;
+    static constexpr std::size_t kReceiveWindow = 256;
+
+    PacketHeader stamp(Channel channel, std::uint16_t channel_sequence, MessageType type);
+    void record_sent(std::uint16_t sequence, std::uint64_t message_id, bool retransmission, Clock::time_point now);
+    void process_acks(std::uint16_t ack, std::uint32_t ack_bits, Clock::time_point now);
+    void acknowledge(std::uint16_t sequence, Clock::time_point now);
+    void add_rtt_sample(std::chrono::microseconds sample);
+    std::chrono::microseconds retransmission_timeout() const;
+
+    // Outgoing
+    std::uint16_t next_sequence_ = 0;
+    std::array<std::uint16_t, 4> next_channel_sequence_{}; // indexed by Channel
+    std::array<SentPacket, kSentPacketWindow> sent_packets_;
+    std::map<std::uint64_t, PendingMessage> pending_; // id -> message; ids increase, so resends keep send order
+    std::uint64_t next_message_id_ = 1;
+    bool failed_ = false;
+
+    // Incoming
+    bool received_any_ = false;
+    std::uint16_t remote_sequence_ = 0;
+    std::uint32_t received_bits_ = 0;
+    bool ack_owed_ = false;
+
+    bool sequenced_received_any_ = false;
+    std::uint16_t last_sequenced_ = 0;
+    std::array<std::int32_t, kReceiveWindow> unordered_received_ = make_empty_window();
+    std::uint16_t next_ordered_ = 0;
+    std::array<BufferedMessage, kReceiveWindow> ordered_buffer_;
+
+    // RTT estimate (RFC 6298)
+    bool has_rtt_ = false;
+    std::chrono::microseconds srtt_{0};
+    std::chrono::microseconds rttvar_{0};
+
+    static std::array<std::int32_t, kReceiveWindow> make_empty_window()
+    {
+        std::array<std::int32_t, kReceiveWindow> window;
+        window.fill(-1);
+        return window;
+    }
+};
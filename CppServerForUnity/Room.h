@@ -1,22 +1,77 @@
 #pragma once
 
-#include <string>
-#include <vector>
-#include <memory>
-#include "asio.hpp"
-
-// 방 정보를 담는 구조체
-#pragma once
-
 #include "stdafx.h"
+#include "EntityId.h"
+#include "Message.h"
+#include "RoomSimulation.h"
+#include "SerializedFragment.h"
+#include "SnapshotQuantization.h"
+#include "SnapshotDelta.h"
+#include "MpscQueue.h"
+#include "WorkStealingPool.h"
 
 // Forward declaration
 class Session;
 
+// A player as its room knows it. The room strand owns all of it: id, token and nickname are copied
+// from the lobby's Player record on entry, and later nickname changes are posted to the room.
+struct RoomMember
+{
+    std::shared_ptr<Session> session;
+    EntityId id;
+    std::uint64_t udp_token = 0;
+    std::string nickname;
+    bool is_ready = false;
+    std::uint32_t joined_tick = 0; // room.snapshot_tick on entry; acks up to it are for another room's snapshots
+    std::uint32_t acked_tick = 0;  // newest snapshot the client confirmed; 0 until it does
+
+    // update_room_info entry (PlayerInfo). Bump version whenever nickname or is_ready change.
+    std::uint64_t version = 1;
+    SerializedFragment info;
+};
+
+// A player_input waiting for the room's next tick.
+struct QueuedInput
+{
+    std::shared_ptr<Session> session;
+    PlayerInputRequest request;
+};
+
+// 방 정보를 담는 구조체
+// id, name and player_count belong to the lobby directory and are only touched on the server
+// strand. Everything else is room state and is only touched on the room's own strand, so rooms
+// never wait on each other.
 struct Room
 {
+    Room(WorkStealingPool &pool, int id, std::string name, float position_precision)
+        : strand(pool.get_executor()), id(id), name(std::move(name)),
+          quantizer(make_position_quantizer(bounds, position_precision)) {}
+
+    asio::strand<WorkStealingPool::executor_type> strand; // on the room pool, not an io thread
+
+    // Pushed from any io thread, drained on the strand at the start of each tick. 512 inputs is
+    // 25 ms of input from 16 players sending at 60 Hz, twice over.
+    MpscQueue<QueuedInput, 512> inputs;
+
+    // Lobby (server strand)
     int id;
     std::string name;
-    std::vector<std::shared_ptr<Session>> players;
+    std::size_t player_count = 0;
+    std::uint64_t listing_version = 1; // bumped with player_count
+    SerializedFragment listing;        // find_rooms_response entry (RoomInfo)
+
+    // Room strand
+    std::vector<RoomMember> players;
+    RoomSimulation simulation; // entry i is players[i]
     std::shared_ptr<Session> host = nullptr;
+    std::mt19937 rng{std::random_device{}()};
+    RoomBounds bounds;
+    PositionQuantizer quantizer; // positions in Encoding::Schema snapshots
+
+    // game_state_update payloads, JSON and deltas, are serialized into these every tick and
+    // sent as they are; a buffer is refilled once the sessions have sent it.
+    MessageBufferPool snapshot_buffers;
+    std::vector<std::pair<std::uint32_t, SharedMessage>> snapshot_deltas; // baseline tick -> delta, during a tick
+    std::uint32_t snapshot_tick = 0;
+    SnapshotHistory snapshot_history; // baselines for Encoding::Schema deltas
 };
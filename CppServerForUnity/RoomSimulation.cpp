@@ -0,0 +1,26 @@
+#include "RoomSimulation.h"
+#include "MovementKernel.h"
+
+void RoomSimulation::add(vec3 position)
+{
+    x.push_back(position.x);
+    y.push_back(position.y);
+    z.push_back(position.z);
+    input_h.push_back(0.0f);
+    input_v.push_back(0.0f);
+    anim_forward.push_back(0.0f);
+    anim_strafe.push_back(0.0f);
+}
+
+void RoomSimulation::remove(std::size_t i)
+{
+    for (auto *field : {&x, &y, &z, &input_h, &input_v, &anim_forward, &anim_strafe})
+    {
+        field->erase(field->begin() + static_cast<std::ptrdiff_t>(i));
+    }
+}
+
+void advance_positions(RoomSimulation &simulation, float distance)
+{
+    integrate_movement({simulation.x.data(), simulation.z.data(), simulation.input_h.data(), simulation.input_v.data(), simulation.size()}, distance);
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+// 3D vector
+struct vec3 {
+    float x, y, z;
+};
+
+// 방 시뮬레이션 상태
+// What a room simulates every tick, one array per field, with entry i belonging to
+// Room::players[i]. A tick streams through a few contiguous arrays instead of visiting each
+// player's record; nicknames and the rest of the lobby data stay in Player. Only touched on the
+// room's strand.
+struct RoomSimulation
+{
+    std::vector<float> x, y, z;         // position
+    std::vector<float> input_h, input_v; // last movement input, -1..1
+    std::vector<float> anim_forward, anim_strafe;
+
+    std::size_t size() const { return x.size(); }
+
+    // Appends an entry at `position`, standing still.
+    void add(vec3 position);
+    // Removes entry `i`, keeping the order of the rest.
+    void remove(std::size_t i);
+};
+
+// Moves every entry `distance` along its input direction (see MovementKernel.h).
+void advance_positions(RoomSimulation &simulation, float distance);
@@ -0,0 +1,305 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <tuple>
+#include <vector>
+#include "Protocol.h"
+#include "EntityId.h"
+
+// 프로토콜 스키마
+// Every message exchanged with the client, mirroring NetworkModels.cs. Each struct lists its fields
+// once in fields(); SchemaCodec.h derives both the JSON and the binary encoding from that list.
+//
+// For the binary encoding the order of fields() is the wire order: append new fields at the end
+// and never reorder them. Field types map to the wire as follows:
+//   bool          u8 (0 or 1)
+//   std::uint8_t  u8
+//   std::uint16_t u16, little-endian
+//   int           zigzag varint
+//   std::uint32_t varint
+//   EntityId      varint (JSON: "UID<n>", see EntityId.h)
+//   float         f32, little-endian
+//   std::string   varint byte length, then UTF-8 bytes
+//   std::vector   varint element count, then the elements
+//   schema struct its fields, in order, with no header
+
+template <class Struct, class Member>
+struct SchemaField
+{
+    const char *name; // JSON key
+    Member Struct::*member;
+};
+
+template <class Struct, class Member>
+constexpr SchemaField<Struct, Member> schema_field(const char *name, Member Struct::*member)
+{
+    return {name, member};
+}
+
+// --- Shared shapes ---
+
+struct PlayerInfo
+{
+    EntityId player_id;
+    std::string nickname;
+    bool is_ready = false;
+
+    static constexpr auto fields()
+    {
+        return std::make_tuple(schema_field("player_id", &PlayerInfo::player_id),
+                               schema_field("nickname", &PlayerInfo::nickname),
+                               schema_field("is_ready", &PlayerInfo::is_ready));
+    }
+};
+
+struct RoomInfo
+{
+    int room_id = 0;
+    std::string room_name;
+    int player_count = 0;
+
+    static constexpr auto fields()
+    {
+        return std::make_tuple(schema_field("room_id", &RoomInfo::room_id),
+                               schema_field("room_name", &RoomInfo::room_name),
+                               schema_field("player_count", &RoomInfo::player_count));
+    }
+};
+
+struct PositionInfo
+{
+    float x = 0, y = 0, z = 0;
+
+    static constexpr auto fields()
+    {
+        return std::make_tuple(schema_field("x", &PositionInfo::x),
+                               schema_field("y", &PositionInfo::y),
+                               schema_field("z", &PositionInfo::z));
+    }
+};
+
+struct AnimationInfo
+{
+    float forward = 0, strafe = 0;
+
+    static constexpr auto fields()
+    {
+        return std::make_tuple(schema_field("forward", &AnimationInfo::forward),
+                               schema_field("strafe", &AnimationInfo::strafe));
+    }
+};
+
+struct PlayerState
+{
+    EntityId player_id;
+    PositionInfo position;
+    AnimationInfo animation;
+
+    static constexpr auto fields()
+    {
+        return std::make_tuple(schema_field("player_id", &PlayerState::player_id),
+                               schema_field("position", &PlayerState::position),
+                               schema_field("animation", &PlayerState::animation));
+    }
+};
+
+// Fixed-point forms of PositionInfo and AnimationInfo; see SnapshotQuantization.h.
+struct QuantizedPosition
+{
+    std::uint16_t x = 0, y = 0, z = 0;
+
+    static constexpr auto fields()
+    {
+        return std::make_tuple(schema_field("x", &QuantizedPosition::x),
+                               schema_field("y", &QuantizedPosition::y),
+                               schema_field("z", &QuantizedPosition::z));
+    }
+};
+
+struct QuantizedAnimation
+{
+    std::uint8_t forward = 128, strafe = 128;
+
+    static constexpr auto fields()
+    {
+        return std::make_tuple(schema_field("forward", &QuantizedAnimation::forward),
+                               schema_field("strafe", &QuantizedAnimation::strafe));
+    }
+};
+
+struct QuantizedPlayerState
+{
+    EntityId player_id;
+    QuantizedPosition position;
+    QuantizedAnimation animation;
+
+    static constexpr auto fields()
+    {
+        return std::make_tuple(schema_field("player_id", &QuantizedPlayerState::player_id),
+                               schema_field("position", &QuantizedPlayerState::position),
+                               schema_field("animation", &QuantizedPlayerState::animation));
+    }
+};
+
+struct InputInfo
+{
+    float h = 0, v = 0, anim_forward = 0, anim_strafe = 0;
+
+    static constexpr auto fields()
+    {
+        return std::make_tuple(schema_field("h", &InputInfo::h),
+                               schema_field("v", &InputInfo::v),
+                               schema_field("anim_forward", &InputInfo::anim_forward),
+                               schema_field("anim_strafe", &InputInfo::anim_strafe));
+    }
+};
+
+// --- Client -> Server ---
+
+struct CreateRoomRequest
+{
+    static constexpr MessageType kType = MessageType::CreateRoom;
+    std::string room_name;
+
+    static constexpr auto fields() { return std::make_tuple(schema_field("room_name", &CreateRoomRequest::room_name)); }
+};
+
+struct FindRoomsRequest
+{
+    static constexpr MessageType kType = MessageType::FindRooms;
+    static constexpr auto fields() { return std::make_tuple(); }
+};
+
+struct JoinRoomRequest
+{
+    static constexpr MessageType kType = MessageType::JoinRoom;
+    int room_id = -1;
+
+    static constexpr auto fields() { return std::make_tuple(schema_field("room_id", &JoinRoomRequest::room_id)); }
+};
+
+struct ChatMessageRequest
+{
+    static constexpr MessageType kType = MessageType::ChatMessage;
+    std::string message;
+
+    static constexpr auto fields() { return std::make_tuple(schema_field("message", &ChatMessageRequest::message)); }
+};
+
+struct LeaveRoomRequest
+{
+    static constexpr MessageType kType = MessageType::LeaveRoom;
+    static constexpr auto fields() { return std::make_tuple(); }
+};
+
+struct ToggleReadyRequest
+{
+    static constexpr MessageType kType = MessageType::ToggleReady;
+    static constexpr auto fields() { return std::make_tuple(); }
+};
+
+struct StartGameRequest
+{
+    static constexpr MessageType kType = MessageType::StartGame;
+    static constexpr auto fields() { return std::make_tuple(); }
+};
+
+struct SetNicknameRequest
+{
+    static constexpr MessageType kType = MessageType::SetNickname;
+    std::string nickname;
+
+    static constexpr auto fields() { return std::make_tuple(schema_field("nickname", &SetNicknameRequest::nickname)); }
+};
+
+struct PlayerInputRequest
+{
+    static constexpr MessageType kType = MessageType::PlayerInput;
+    InputInfo input;
+
+    static constexpr auto fields() { return std::make_tuple(schema_field("input", &PlayerInputRequest::input)); }
+};
+
+struct SnapshotAckRequest
+{
+    static constexpr MessageType kType = MessageType::SnapshotAck;
+    std::uint32_t tick = 0;
+
+    static constexpr auto fields() { return std::make_tuple(schema_field("tick", &SnapshotAckRequest::tick)); }
+};
+
+struct UdpConfirmRequest
+{
+    static constexpr MessageType kType = MessageType::UdpConfirm;
+    std::uint64_t challenge = 0;
+
+    static constexpr auto fields() { return std::make_tuple(schema_field("challenge", &UdpConfirmRequest::challenge)); }
+};
+
+// --- Server -> Client ---
+
+struct AssignIdPayload
+{
+    static constexpr MessageType kType = MessageType::AssignId;
+    EntityId player_id;
+    std::uint64_t udp_token = 0;
+
+    static constexpr auto fields()
+    {
+        return std::make_tuple(schema_field("player_id", &AssignIdPayload::player_id),
+                               schema_field("udp_token", &AssignIdPayload::udp_token));
+    }
+};
+
+struct UpdateRoomInfoPayload
+{
+    static constexpr MessageType kType = MessageType::UpdateRoomInfo;
+    std::string room_name;
+    EntityId host_id;
+    std::vector<PlayerInfo> players;
+
+    static constexpr auto fields()
+    {
+        return std::make_tuple(schema_field("room_name", &UpdateRoomInfoPayload::room_name),
+                               schema_field("host_id", &UpdateRoomInfoPayload::host_id),
+                               schema_field("players", &UpdateRoomInfoPayload::players));
+    }
+};
+
+struct FindRoomsResponse
+{
+    static constexpr MessageType kType = MessageType::FindRoomsResponse;
+    std::vector<RoomInfo> rooms;
+
+    static constexpr auto fields() { return std::make_tuple(schema_field("rooms", &FindRoomsResponse::rooms)); }
+};
+
+struct ChatBroadcastPayload
+{
+    static constexpr MessageType kType = MessageType::ChatBroadcast;
+    std::string sender_id;
+    std::string message;
+
+    static constexpr auto fields()
+    {
+        return std::make_tuple(schema_field("sender_id", &ChatBroadcastPayload::sender_id),
+                               schema_field("message", &ChatBroadcastPayload::message));
+    }
+};
+
+struct LeaveRoomSuccessPayload
+{
+    static constexpr MessageType kType = MessageType::LeaveRoomSuccess;
+    static constexpr auto fields() { return std::make_tuple(); }
+};
+
+// game_state_update as JSON clients receive it. Encoding::Schema clients receive delta-compressed
+// snapshots instead, described in SnapshotDelta.h.
+struct GameStateUpdatePayload
+{
+    static constexpr MessageType kType = MessageType::GameStateUpdate;
+    std::vector<PlayerState> players;
+
+    static constexpr auto fields() { return std::make_tuple(schema_field("players", &GameStateUpdatePayload::players)); }
+};
@@ -0,0 +1,481 @@
+#pragma once
+
+#include "stdafx.h"
+#include "Schema.h"
+#include "Message.h"
+#include "JsonWriter.h"
+#include <cstring>
+#include <numeric>
+#include <stdexcept>
+#include <type_traits>
+
+// 스키마 기반 인코더/디코더
+// Encoders and decoders for every struct in Schema.h, instantiated from their fields() lists.
+// JSON is streamed straight into the output with JsonWriter, byte-identical to building the same
+// nlohmann::json by hand and dumping it; the binary encoding is described at the top of Schema.h.
+
+// Thrown for a binary payload that does not match its message's schema.
+struct SchemaDecodeError : std::runtime_error
+{
+    using std::runtime_error::runtime_error;
+};
+
+namespace schema_detail
+{
+    template <class T>
+    struct is_vector : std::false_type
+    {
+    };
+    template <class T>
+    struct is_vector<std::vector<T>> : std::true_type
+    {
+    };
+
+    template <class T, class Fn>
+    void for_each_field(Fn &&fn)
+    {
+        std::apply([&](const auto &...field)
+                   { (fn(field), ...); },
+                   T::fields());
+    }
+
+    template <class T, class Fn>
+    void visit_field(std::size_t index, Fn &&fn)
+    {
+        std::size_t i = 0;
+        std::apply([&](const auto &...field)
+                   { ((i++ == index ? fn(field) : void()), ...); },
+                   T::fields());
+    }
+
+    template <class T>
+    constexpr std::size_t field_count = std::tuple_size_v<decltype(T::fields())>;
+
+    // json objects keep their keys in a std::map, so dump() writes them sorted. Field indices of T
+    // in that order, computed once per type.
+    template <class T>
+    const std::array<std::size_t, field_count<T>> &json_key_order()
+    {
+        static const auto order = []
+        {
+            std::array<std::string_view, field_count<T>> names{};
+            std::size_t i = 0;
+            for_each_field<T>([&](const auto &field)
+                              { names[i++] = field.name; });
+            std::array<std::size_t, field_count<T>> sorted{};
+            std::iota(sorted.begin(), sorted.end(), std::size_t{0});
+            std::sort(sorted.begin(), sorted.end(), [&](std::size_t a, std::size_t b)
+                      { return names[a] < names[b]; });
+            return sorted;
+        }();
+        return order;
+    }
+
+    // Strict UTF-8: no overlong forms, surrogates or code points above U+10FFFF.
+    inline bool is_valid_utf8(std::string_view text)
+    {
+        std::size_t i = 0;
+        while (i < text.size())
+        {
+            const auto c = static_cast<std::uint8_t>(text[i]);
+            std::size_t length;
+            std::uint32_t code_point;
+            if (c < 0x80)
+            {
+                ++i;
+                continue;
+            }
+            else if ((c & 0xe0) == 0xc0)
+                length = 2, code_point = c & 0x1f;
+            else if ((c & 0xf0) == 0xe0)
+                length = 3, code_point = c & 0x0f;
+            else if ((c & 0xf8) == 0xf0)
+                length = 4, code_point = c & 0x07;
+            else
+                return false;
+
+            if (text.size() - i < length)
+                return false;
+            for (std::size_t k = 1; k < length; ++k)
+            {
+                const auto continuation = static_cast<std::uint8_t>(text[i + k]);
+                if ((continuation & 0xc0) != 0x80)
+                    return false;
+                code_point = code_point << 6 | (continuation & 0x3f);
+            }
+            static constexpr std::uint32_t kMinCodePoint[] = {0, 0, 0x80, 0x800, 0x10000};
+            if (code_point < kMinCodePoint[length] || code_point > 0x10ffff || (code_point >= 0xd800 && code_point <= 0xdfff))
+                return false;
+            i += length;
+        }
+        return true;
+    }
+
+    // "UID<n>", or "" for no player.
+    inline EntityId parse_entity_id(std::string_view text)
+    {
+        EntityId id;
+        if (text.empty())
+            return id;
+        if (text.substr(0, kEntityIdPrefix.size()) != kEntityIdPrefix)
+            throw SchemaDecodeError("bad entity id");
+        text.remove_prefix(kEntityIdPrefix.size());
+        const char *end = text.data() + text.size();
+        std::uint32_t number = 0;
+        const auto result = std::from_chars(text.data(), end, number);
+        if (result.ec != std::errc() || result.ptr != end || number == UINT32_MAX)
+            throw SchemaDecodeError("bad entity id");
+        id.value = number + 1;
+        return id;
+    }
+
+    class BinaryWriter
+    {
+    public:
+        explicit BinaryWriter(std::string &out) : out_(out) {}
+
+        void varint(std::uint64_t value)
+        {
+            while (value >= 0x80)
+            {
+                out_.push_back(static_cast<char>(value | 0x80));
+                value >>= 7;
+            }
+            out_.push_back(static_cast<char>(value));
+        }
+
+        void f32(float value)
+        {
+            std::uint32_t bits;
+            std::memcpy(&bits, &value, sizeof(bits));
+            for (int i = 0; i < 4; ++i)
+            {
+                out_.push_back(static_cast<char>(bits >> (8 * i)));
+            }
+        }
+
+        void bytes(std::string_view value)
+        {
+            varint(value.size());
+            out_.append(value);
+        }
+
+        void u8(std::uint8_t value) { out_.push_back(static_cast<char>(value)); }
+
+        void u16(std::uint16_t value)
+        {
+            out_.push_back(static_cast<char>(value));
+            out_.push_back(static_cast<char>(value >> 8));
+        }
+
+    private:
+        std::string &out_;
+    };
+
+    class BinaryReader
+    {
+    public:
+        explicit BinaryReader(std::string_view in) : in_(in) {}
+
+        std::uint64_t varint()
+        {
+            std::uint64_t value = 0;
+            for (int shift = 0; shift < 64; shift += 7)
+            {
+                const std::uint8_t byte = u8();
+                value |= static_cast<std::uint64_t>(byte & 0x7f) << shift;
+                if ((byte & 0x80) == 0)
+                {
+                    return value;
+                }
+            }
+            throw SchemaDecodeError("varint too long");
+        }
+
+        float f32()
+        {
+            need(4);
+            std::uint32_t bits = 0;
+            for (int i = 0; i < 4; ++i)
+            {
+                bits |= static_cast<std::uint32_t>(static_cast<std::uint8_t>(in_[pos_++])) << (8 * i);
+            }
+            float value;
+            std::memcpy(&value, &bits, sizeof(value));
+            return value;
+        }
+
+        std::string_view bytes()
+        {
+            const std::uint64_t length = varint();
+            need(length);
+            std::string_view value = in_.substr(pos_, length);
+            pos_ += length;
+            return value;
+        }
+
+        std::uint8_t u8()
+        {
+            need(1);
+            return static_cast<std::uint8_t>(in_[pos_++]);
+        }
+
+        std::uint16_t u16()
+        {
+            need(2);
+            const auto low = static_cast<std::uint8_t>(in_[pos_++]);
+            const auto high = static_cast<std::uint8_t>(in_[pos_++]);
+            return static_cast<std::uint16_t>(low | high << 8);
+        }
+
+        std::size_t remaining() const { return in_.size() - pos_; }
+
+    private:
+        void need(std::uint64_t count) const
+        {
+            if (count > in_.size() - pos_)
+            {
+                throw SchemaDecodeError("truncated payload");
+            }
+        }
+
+        std::string_view in_;
+        std::size_t pos_ = 0;
+    };
+
+    template <class T>
+    void write_binary(BinaryWriter &writer, const T &value)
+    {
+        if constexpr (std::is_same_v<T, bool>)
+            writer.u8(value ? 1 : 0);
+        else if constexpr (std::is_same_v<T, std::uint8_t>)
+            writer.u8(value);
+        else if constexpr (std::is_same_v<T, std::uint16_t>)
+            writer.u16(value);
+        else if constexpr (std::is_same_v<T, EntityId>)
+            writer.varint(value.value);
+        else if constexpr (std::is_same_v<T, float>)
+            writer.f32(value);
+        else if constexpr (std::is_same_v<T, std::string>)
+            writer.bytes(value);
+        else if constexpr (std::is_integral_v<T> && std::is_signed_v<T>)
+            writer.varint((static_cast<std::uint64_t>(value) << 1) ^ static_cast<std::uint64_t>(value < 0 ? -1 : 0));
+        else if constexpr (std::is_integral_v<T>)
+            writer.varint(value);
+        else if constexpr (is_vector<T>::value)
+        {
+            writer.varint(value.size());
+            for (const auto &element : value)
+                write_binary(writer, element);
+        }
+        else
+            for_each_field<T>([&](const auto &field)
+                              { write_binary(writer, value.*field.member); });
+    }
+
+    template <class T>
+    void read_binary(BinaryReader &reader, T &value)
+    {
+        if constexpr (std::is_same_v<T, bool>)
+            value = reader.u8() != 0;
+        else if constexpr (std::is_same_v<T, std::uint8_t>)
+            value = reader.u8();
+        else if constexpr (std::is_same_v<T, std::uint16_t>)
+            value = reader.u16();
+        else if constexpr (std::is_same_v<T, EntityId>)
+        {
+            const std::uint64_t id = reader.varint();
+            if (id > UINT32_MAX)
+                throw SchemaDecodeError("bad entity id");
+            value.value = static_cast<std::uint32_t>(id);
+        }
+        else if constexpr (std::is_same_v<T, float>)
+            value = reader.f32();
+        else if constexpr (std::is_same_v<T, std::string>)
+        {
+            const std::string_view bytes = reader.bytes();
+            // Strings are echoed to JSON clients, which must only ever see valid UTF-8.
+            if (!is_valid_utf8(bytes))
+                throw SchemaDecodeError("invalid UTF-8");
+            value = std::string(bytes);
+        }
+        else if constexpr (std::is_integral_v<T> && std::is_signed_v<T>)
+        {
+            const std::uint64_t zigzag = reader.varint();
+            value = static_cast<T>(static_cast<std::int64_t>(zigzag >> 1) ^ -static_cast<std::int64_t>(zigzag & 1));
+        }
+        else if constexpr (std::is_integral_v<T>)
+            value = static_cast<T>(reader.varint());
+        else if constexpr (is_vector<T>::value)
+        {
+            const std::uint64_t count = reader.varint();
+            // Every element takes at least one byte, which bounds the allocation by the payload size.
+            if (count > reader.remaining())
+                throw SchemaDecodeError("bad element count");
+            value.resize(count);
+            for (auto &element : value)
+                read_binary(reader, element);
+        }
+        else
+            for_each_field<T>([&](const auto &field)
+                              { read_binary(reader, value.*field.member); });
+    }
+
+    // `type_name`, if given, is written as the object's "type" key, in sorted position.
+    template <class T>
+    void write_json(JsonWriter &writer, const T &value, const char *type_name = nullptr)
+    {
+        if constexpr (std::is_same_v<T, bool>)
+            writer.boolean(value);
+        else if constexpr (std::is_floating_point_v<T>)
+            writer.number(value);
+        else if constexpr (std::is_integral_v<T>)
+            writer.integer(value);
+        else if constexpr (std::is_same_v<T, std::string>)
+            writer.string(value);
+        else if constexpr (std::is_same_v<T, EntityId>)
+        {
+            writer.raw('"');
+            if (value)
+            {
+                writer.raw(kEntityIdPrefix);
+                writer.integer(value.value - 1);
+            }
+            writer.raw('"');
+        }
+        else if constexpr (is_vector<T>::value)
+        {
+            writer.raw('[');
+            for (std::size_t i = 0; i < value.size(); ++i)
+            {
+                if (i != 0)
+                    writer.raw(',');
+                write_json(writer, value[i]);
+            }
+            writer.raw(']');
+        }
+        else
+        {
+            bool first = true;
+            auto write_key = [&](std::string_view key)
+            {
+                writer.raw(first ? '{' : ',');
+                first = false;
+                writer.key(key);
+            };
+            for (const std::size_t index : json_key_order<T>())
+            {
+                visit_field<T>(index, [&](const auto &field)
+                               {
+                    if (type_name && std::string_view(field.name) > "type")
+                    {
+                        write_key("type");
+                        writer.string(type_name);
+                        type_name = nullptr;
+                    }
+                    write_key(field.name);
+                    write_json(writer, value.*field.member); });
+            }
+            if (type_name)
+            {
+                write_key("type");
+                writer.string(type_name);
+            }
+            writer.raw(first ? "{}" : "}");
+        }
+    }
+
+    // `Json` is any nlohmann::basic_json; requests are parsed into request_json (JsonArena.h).
+    template <class Json, class T>
+    void from_json_value(const Json &j, T &value)
+    {
+        if constexpr (std::is_same_v<T, std::string>)
+        {
+            const auto &text = j.template get_ref<const typename Json::string_t &>();
+            value.assign(text.data(), text.size());
+        }
+        else if constexpr (std::is_arithmetic_v<T>)
+            value = j.template get<T>();
+        else if constexpr (std::is_same_v<T, EntityId>)
+        {
+            const auto &text = j.template get_ref<const typename Json::string_t &>();
+            value = parse_entity_id(std::string_view(text.data(), text.size()));
+        }
+        else if constexpr (is_vector<T>::value)
+        {
+            value.clear();
+            for (const auto &element : j)
+                from_json_value(element, value.emplace_back());
+        }
+        else
+            for_each_field<T>([&](const auto &field)
+                              { from_json_value(j.at(field.name), value.*field.member); });
+    }
+}
+
+// --- Messages ---
+
+// Append one schema value (a message, a nested struct, or a scalar) to `out`. These let a
+// caller stream a large message piece by piece into a buffer it reuses.
+template <class T>
+void append_json(std::string &out, const T &value)
+{
+    JsonWriter writer(out);
+    schema_detail::write_json(writer, value);
+}
+
+template <class T>
+void append_binary(std::string &out, const T &value)
+{
+    schema_detail::BinaryWriter writer(out);
+    schema_detail::write_binary(writer, value);
+}
+
+template <class Message>
+std::string encode_json(const Message &message)
+{
+    std::string out;
+    JsonWriter writer(out);
+    schema_detail::write_json(writer, message, to_string(Message::kType));
+    return out;
+}
+
+template <class Message>
+std::string encode_binary(const Message &message)
+{
+    std::string out;
+    append_binary(out, message);
+    return out;
+}
+
+// Throws json::exception if a field is missing or has the wrong type.
+template <class Message, class Json>
+Message decode_json(const Json &j)
+{
+    Message message;
+    schema_detail::from_json_value(j, message);
+    return message;
+}
+
+// Throws SchemaDecodeError if the payload is truncated or has trailing bytes.
+template <class Message>
+Message decode_binary(std::string_view payload)
+{
+    Message message;
+    schema_detail::BinaryReader reader(payload);
+    schema_detail::read_binary(reader, message);
+    if (reader.remaining() != 0)
+    {
+        throw SchemaDecodeError("trailing bytes");
+    }
+    return message;
+}
+
+// Serializes `message` once per encoding, when the first recipient using that encoding sends it;
+// every recipient then shares the bytes for its own.
+template <class Message>
+OutboundMessage make_outbound(const Message &message)
+{
+    return make_outbound_message(Message::kType, [message](Encoding encoding)
+                                 { return encoding == Encoding::Schema ? encode_binary(message) : encode_json(message); });
+}
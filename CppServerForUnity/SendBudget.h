@@ -0,0 +1,29 @@
+#pragma once
+
+#include "stdafx.h"
+#include <string_view>
+
+// What a session does once a slow client has more than max_pending_bytes waiting to be sent.
+enum class SlowConsumerPolicy
+{
+    Drop,        // discard the message that does not fit
+    DegradeRate, // send fewer snapshots until the backlog drains; disconnect at twice the budget
+    Disconnect,  // close the connection
+};
+
+// Per-session outbound limit. Snapshots never queue up regardless: a session holds at most one
+// unsent game_state_update and a newer one replaces it.
+struct SendBudget
+{
+    std::size_t max_pending_bytes = 256 * 1024;
+    SlowConsumerPolicy policy = SlowConsumerPolicy::DegradeRate;
+};
+
+inline bool parse_slow_consumer_policy(std::string_view name, SlowConsumerPolicy &policy)
+{
+    if (name == "drop") policy = SlowConsumerPolicy::Drop;
+    else if (name == "degrade") policy = SlowConsumerPolicy::DegradeRate;
+    else if (name == "disconnect") policy = SlowConsumerPolicy::Disconnect;
+    else return false;
+    return true;
+}
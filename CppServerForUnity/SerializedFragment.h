@@ -0,0 +1,108 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "SchemaCodec.h"
+
+// 직렬화 조각 캐시
+// One schema value in either encoding, kept until the state it was built from changes. Messages
+// that list many such values (room rosters, room lists) are assembled by concatenating fragments
+// instead of re-serializing every entry. The result is byte-identical to make_outbound().
+//
+// Messages are encoded lazily, on whichever thread first sends them, so they hold on to the
+// encoded fragments they list. A refresh therefore builds new ones instead of rewriting them.
+// Each encoding of a fragment is likewise only built the first time a message needs it, so a
+// value that only JSON sessions see is never serialized to binary, and the other way round.
+struct SerializedFragment
+{
+    struct Encoded
+    {
+        std::function<void(std::string &, Encoding)> encode; // appends the value in one encoding
+        mutable std::once_flag built[2];
+        mutable std::string bytes[2];
+
+        // Safe to call from any thread.
+        const std::string &get(Encoding encoding) const
+        {
+            const auto index = static_cast<std::size_t>(encoding);
+            std::call_once(built[index], [&]
+                           { encode(bytes[index], encoding); });
+            return bytes[index];
+        }
+    };
+
+    std::uint64_t version = 0; // of the source state when built; sources start at 1, so 0 is stale
+    std::shared_ptr<const Encoded> encoded;
+
+    // Starts fresh encodings of a copy of `value` unless the current ones are from `source_version`.
+    template <class Value>
+    const std::shared_ptr<const Encoded> &refresh(std::uint64_t source_version, const Value &value)
+    {
+        if (version != source_version)
+        {
+            auto fresh = std::make_shared<Encoded>();
+            fresh->encode = [value](std::string &out, Encoding encoding)
+            {
+                if (encoding == Encoding::Schema)
+                {
+                    append_binary(out, value);
+                }
+                else
+                {
+                    append_json(out, value);
+                }
+            };
+            encoded = std::move(fresh);
+            version = source_version;
+        }
+        return encoded;
+    }
+};
+
+using FragmentList = std::vector<std::shared_ptr<const SerializedFragment::Encoded>>;
+
+// Appends `fragments` as a JSON array or as a binary vector.
+inline void append_fragment_list(std::string &out, Encoding encoding, const FragmentList &fragments)
+{
+    if (encoding == Encoding::Schema)
+    {
+        append_binary(out, static_cast<std::uint64_t>(fragments.size()));
+        for (const auto &fragment : fragments)
+        {
+            out.append(fragment->get(encoding));
+        }
+        return;
+    }
+
+    out.push_back('[');
+    for (std::size_t i = 0; i < fragments.size(); ++i)
+    {
+        if (i != 0)
+        {
+            out.push_back(',');
+        }
+        out.append(fragments[i]->get(encoding));
+    }
+    out.push_back(']');
+}
+
+// find_rooms_response listing `rooms` (RoomInfo fragments).
+inline OutboundMessage make_room_list(FragmentList rooms)
+{
+    return make_outbound_message(MessageType::FindRoomsResponse, [rooms = std::move(rooms)](Encoding encoding)
+                                 {
+        std::string out;
+        if (encoding == Encoding::Schema)
+        {
+            append_fragment_list(out, encoding, rooms);
+            return out;
+        }
+        out.assign("{\"rooms\":");
+        append_fragment_list(out, encoding, rooms);
+        out.append(",\"type\":\"find_rooms_response\"}");
+        return out; });
+}
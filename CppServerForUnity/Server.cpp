@@ -1,26 +1,113 @@
 
 #include "Server.h"
 #include "Session.h"
+#include "SchemaCodec.h"
+#include "PlayerInputDecoder.h"
+#include "SnapshotQuantization.h"
 
-Server::Server(asio::io_context &io_context, short port)
-    : io_context_(io_context),
-      acceptor_(io_context, tcp::endpoint(tcp::v4(), port)),
-      server_strand_(io_context.get_executor()),
-      game_loop_timer_(io_context)
+namespace
+{
+    // Every shard listens on the same port; the kernel spreads incoming connections between them.
+    tcp::acceptor make_reuse_port_acceptor(asio::io_context &io_context, unsigned short port)
+    {
+#ifdef SO_REUSEPORT
+        using reuse_port = asio::detail::socket_option::boolean<SOL_SOCKET, SO_REUSEPORT>;
+        tcp::acceptor acceptor(io_context);
+        const tcp::endpoint endpoint(tcp::v4(), port);
+        acceptor.open(endpoint.protocol());
+        acceptor.set_option(tcp::acceptor::reuse_address(true));
+        acceptor.set_option(reuse_port(true));
+        acceptor.bind(endpoint);
+        acceptor.listen();
+        return acceptor;
+#else
+        throw std::runtime_error("sharded mode requires SO_REUSEPORT");
+#endif
+    }
+
+    // Runs `f` when the scope ends, whether normally or by an exception.
+    template <class F>
+    struct ScopeExit
+    {
+        F f;
+        ~ScopeExit() { f(); }
+    };
+    template <class F>
+    ScopeExit(F) -> ScopeExit<F>;
+
+    // The request type a handler takes, and where it runs: on a room strand, on the lobby strand,
+    // or, for const handlers, which cannot touch the lobby's state, right on the receiving thread.
+    template <class Handler>
+    struct handler_traits;
+
+    template <class Request>
+    struct handler_traits<void (Server::*)(std::shared_ptr<Session>, const Request &)>
+    {
+        using request = Request;
+        static constexpr bool room = false;
+        static constexpr bool direct = false;
+    };
+
+    template <class Request>
+    struct handler_traits<void (Server::*)(std::shared_ptr<Session>, const Request &) const>
+    {
+        using request = Request;
+        static constexpr bool room = false;
+        static constexpr bool direct = true;
+    };
+
+    template <class Request>
+    struct handler_traits<void (Server::*)(Room &, std::shared_ptr<Session>, const Request &)>
+    {
+        using request = Request;
+        static constexpr bool room = true;
+        static constexpr bool direct = false;
+    };
+}
+
+Server::Server(asio::io_context &io_context, unsigned short port, std::size_t room_threads)
+    : acceptor_(io_context, tcp::endpoint(tcp::v4(), port)),
+      owned_udp_channel_(std::make_unique<UdpChannel>(io_context, port)),
+      udp_channel_(*owned_udp_channel_),
+      owned_room_pool_(std::make_unique<WorkStealingPool>(room_threads != 0 ? room_threads : WorkStealingPool::default_thread_count())),
+      room_pool_(*owned_room_pool_),
+      io_context_(io_context),
+      game_loop_timer_(io_context),
+      server_strand_(io_context.get_executor())
 {
-    initialize_request_handlers();
     std::cout << "Server started on port " << port << std::endl;
 }
 
-void Server::run()
+Server::Server(asio::io_context &io_context, unsigned short port, UdpChannel &udp_channel, LobbyDirectory &lobby, WorkStealingPool &room_pool, int shard_index)
+    : acceptor_(make_reuse_port_acceptor(io_context, port)),
+      udp_channel_(udp_channel),
+      room_pool_(room_pool),
+      lobby_(&lobby),
+      shard_index_(shard_index),
+      shard_count_(lobby.shard_count()),
+      io_context_(io_context),
+      game_loop_timer_(io_context),
+      server_strand_(io_context.get_executor()),
+      players_(static_cast<std::uint32_t>(shard_index))
+{
+    lobby.set_shard(shard_index, *this);
+}
+
+void Server::start()
 {
     start_accept();
     start_game_loop();
+}
+
+void Server::run()
+{
+    start();
+    udp_channel_.start();
 
     // Create a thread pool to run the io_context
-    const int thread_count = std::max(1, (int)std::thread::hardware_concurrency());
+    const std::size_t thread_count = io_thread_count();
     thread_pool_.reserve(thread_count);
-    for (int i = 0; i < thread_count; ++i)
+    for (std::size_t i = 0; i < thread_count; ++i)
     {
         thread_pool_.emplace_back([this]()
                                   { io_context_.run(); });
@@ -35,13 +122,19 @@ void Server::run()
     }
 }
 
+// A standalone server's io threads only handle sockets and the lobby; rooms run on the pool.
+std::size_t Server::io_thread_count()
+{
+    return std::max(1u, std::thread::hardware_concurrency() / 2);
+}
+
 void Server::start_accept()
 {
     acceptor_.async_accept([this](const asio::error_code &error, tcp::socket socket)
                            {
         if (!error)
         {
-            std::make_shared<Session>(std::move(socket), *this)->start();
+            std::make_shared<Session>(std::move(socket), *this, send_budget_)->start();
         }
         start_accept(); });
 }
@@ -50,353 +143,750 @@ void Server::handle_connect(std::shared_ptr<Session> session)
 {
     asio::post(server_strand_, [this, session]()
                {
-        std::string player_id = "UID" + std::to_string(next_player_id_num_++);
-        connected_players_[session] = { player_id, "", -1, false };
-        std::cout << player_id << " connected." << std::endl;
+        // Player numbers are interleaved between shards so they stay unique without coordination;
+        // a single shard numbers players UID0, UID1, ... as it always has.
+        const int number = next_player_id_num_++ * shard_count_ + shard_index_;
+        const EntityId player_id{static_cast<std::uint32_t>(number + 1)};
+        Player player;
+        player.id = player_id;
+        player.udp_token = udp_channel_.register_session(session);
+        const std::uint64_t udp_token = player.udp_token;
+        const PlayerHandle handle = players_.insert(std::move(player));
+        if (!handle)
+        {
+            std::cerr << "Player limit reached, ignoring " << to_string(player_id) << std::endl;
+            udp_channel_.unregister_session(udp_token);
+            return;
+        }
+        session->set_player(handle);
+        std::cout << to_string(player_id) << " connected." << std::endl;
 
-        json id_message;
-        id_message["type"] = "assign_id";
-        id_message["player_id"] = player_id;
-        session->write(id_message.dump()); });
+        session->write(make_outbound(AssignIdPayload{player_id, udp_token})); });
 }
 
 void Server::handle_disconnect(std::shared_ptr<Session> session)
 {
     asio::post(server_strand_, [this, session]()
                {
-        if (connected_players_.find(session) == connected_players_.end())
+        const PlayerHandle handle = session->player();
+        Player *player = players_.get(handle);
+        if (!player)
             return;
 
-        int current_room_id = connected_players_[session].room_id;
-        std::string leaving_player_id = connected_players_[session].id;
+        std::cout << to_string(player->id) << " disconnected." << std::endl;
+        udp_channel_.unregister_session(player->udp_token);
 
-        std::cout << leaving_player_id << " disconnected." << std::endl;
+        leave_current_room(session, false);
+        session->set_player({});
+        players_.erase(handle); });
+}
 
-        if (current_room_id != -1 && active_rooms_.count(current_room_id))
-        {
-            auto& room = active_rooms_[current_room_id];
-            room.players.erase(std::remove(room.players.begin(), room.players.end(), session), room.players.end());
+// --- Request dispatch ---
+// Every request id maps to a dispatch<Handler> instantiation through a table built at compile
+// time, so routing a request is an array index and a direct call. Adding a handler is one line in
+// make_request_table(); its request type comes from the handler's signature.
 
-            if (room.players.empty())
-            {
-                active_rooms_.erase(current_room_id);
-            }
-            else
-            {
-                if (room.host == session)
-                {
-                    room.host = room.players.front();
-                }
-                broadcast_room_update(current_room_id);
-            }
-        }
-        connected_players_.erase(session); });
+template <auto Handler>
+constexpr void Server::add_handler(RequestTable &table)
+{
+    using Request = typename handler_traits<decltype(Handler)>::request;
+    constexpr auto index = static_cast<std::size_t>(Request::kType);
+    static_assert(index > 0 && index < kRequestTypeCount, "handlers take Client -> Server requests");
+    if (table[index] != nullptr)
+    {
+        throw "two handlers for one request type"; // not a constant expression: fails the build
+    }
+    table[index] = &Server::dispatch<Handler>;
+}
+
+constexpr Server::RequestTable Server::make_request_table()
+{
+    RequestTable table{};
+    add_handler<&Server::handle_create_room>(table);
+    add_handler<&Server::handle_find_rooms>(table);
+    add_handler<&Server::handle_join_room>(table);
+    add_handler<&Server::handle_leave_room>(table);
+    add_handler<&Server::handle_set_nickname>(table);
+    add_handler<&Server::handle_udp_confirm>(table);
+
+    add_handler<&Server::handle_chat_message>(table);
+    add_handler<&Server::handle_toggle_ready>(table);
+    add_handler<&Server::handle_start_game>(table);
+    add_handler<&Server::queue_player_input>(table);
+    add_handler<&Server::handle_snapshot_ack>(table);
+    return table;
+}
+
+// Decodes the request and posts it to the lobby or room strand that runs `Handler`, or runs a
+// direct handler right away.
+template <auto Handler>
+void Server::dispatch(std::shared_ptr<Session> session, const EncodedRequest &encoded)
+{
+    using Traits = handler_traits<decltype(Handler)>;
+    using Request = typename Traits::request;
+    Request request = encoded.object ? decode_json<Request>(*encoded.object) : decode_binary<Request>(encoded.bytes);
+    if constexpr (Traits::direct)
+    {
+        (this->*Handler)(std::move(session), request);
+    }
+    else if constexpr (Traits::room)
+    {
+        post_room_request(std::move(session), Handler, std::move(request));
+    }
+    else
+    {
+        // Lobby requests run on the server strand, which owns the room directory.
+        asio::post(server_strand_, [this, session = std::move(session), request = std::move(request)]()
+                   {
+            // Requests that were in flight while the player moved to another shard are dropped.
+            if (!players_.get(session->player()))
+                return;
+            (this->*Handler)(session, request); });
+    }
+}
+
+// Room requests skip the lobby and go straight to the strand of the sender's room.
+template <class Request>
+void Server::post_room_request(std::shared_ptr<Session> session, void (Server::*handler)(Room &, std::shared_ptr<Session>, const Request &), Request request)
+{
+    auto room = session->room();
+    if (!room)
+        return;
+    asio::post(room->strand, [this, handler, room, session = std::move(session), request = std::move(request)]()
+               { (this->*handler)(*room, session, request); });
+}
+
+// player_input is the one room request that is not posted: it goes into the room's input queue,
+// and the room applies everything queued, in arrival order, when its next tick starts. A full
+// queue drops the input; the player's next one supersedes it anyway.
+void Server::queue_player_input(std::shared_ptr<Session> session, const PlayerInputRequest &request) const
+{
+    auto room = session->room();
+    if (!room)
+        return;
+    room->inputs.try_push({std::move(session), request});
 }
 
-void Server::handle_request(std::shared_ptr<Session> session, const std::string &message)
+// `type` is the frame's message id for binary framing, or MessageType::Unknown for newline
+// JSON, in which case it is taken from the message's "type" field. The request is decoded here,
+// before `message` goes out of scope, and handed to its strand fully parsed.
+void Server::handle_request(std::shared_ptr<Session> session, MessageType type, std::string_view message)
 {
     try
     {
-        auto request_json = json::parse(message);
-        std::string type = request_json.value("type", "");
+        // player_input is by far the most frequent request; the common shape is decoded
+        // without a DOM and goes straight to the room's input queue.
+        PlayerInputRequest input;
+        if (session->encoding() == Encoding::Json &&
+            (type == MessageType::Unknown || type == MessageType::PlayerInput) &&
+            decode_player_input(message, type == MessageType::Unknown, input))
+        {
+            queue_player_input(std::move(session), input);
+            return;
+        }
 
-        auto it = request_handlers_.find(type);
-        if (it != request_handlers_.end())
+        // The parsed DOM lives in this thread's arena. Handlers decode it before they post, so
+        // the arena is reset as soon as this returns and nothing parsed is freed on another thread.
+        JsonArenaScope arena;
+        EncodedRequest request;
+        request_json parsed;
+        if (session->encoding() == Encoding::Schema)
         {
-            // Post the handler to the server's main strand to ensure all state changes are synchronized
-            asio::post(server_strand_, [this, session, request_json, handler = it->second]()
-                       { handler(session, request_json); });
+            request.bytes = message;
         }
         else
         {
-            std::cerr << "Unknown request type: " << type << std::endl;
+            parsed = request_json::parse(message);
+            if (type == MessageType::Unknown)
+            {
+                type = message_type_from_string(parsed.value("type", ""));
+            }
+            request.object = &parsed;
+        }
+
+        static constexpr RequestTable kRequestTable = make_request_table();
+        const auto index = static_cast<std::size_t>(type);
+        const RequestDispatcher handler = index < kRequestTypeCount ? kRequestTable[index] : nullptr;
+        if (handler)
+        {
+            (this->*handler)(std::move(session), request);
+        }
+        else
+        {
+            std::cerr << "Unknown request type: " << (request.object ? std::string(parsed.value("type", "")) : std::to_string(static_cast<int>(type))) << std::endl;
         }
     }
-    catch (json::parse_error &e)
+    catch (json::exception &e)
     {
         std::cerr << "JSON parse error: " << e.what() << std::endl;
     }
+    catch (SchemaDecodeError &e)
+    {
+        std::cerr << "Malformed " << to_string(type) << " request: " << e.what() << std::endl;
+    }
 }
 
-// --- Request Handler Implementations ---
-// All handlers are now executed within the server_strand_, so no explicit locking is needed.
-
-void Server::initialize_request_handlers()
-{
-    request_handlers_["create_room"] = [this](auto session, const json &req)
-    { handle_create_room(session, req); };
-    request_handlers_["find_rooms"] = [this](auto session, const json &req)
-    { handle_find_rooms(session, req); };
-    request_handlers_["join_room"] = [this](auto session, const json &req)
-    { handle_join_room(session, req); };
-    request_handlers_["chat_message"] = [this](auto session, const json &req)
-    { handle_chat_message(session, req); };
-    request_handlers_["leave_room"] = [this](auto session, const json &req)
-    { handle_leave_room(session, req); };
-    request_handlers_["toggle_ready"] = [this](auto session, const json &req)
-    { handle_toggle_ready(session, req); };
-    request_handlers_["start_game"] = [this](auto session, const json &req)
-    { handle_start_game(session, req); };
-    request_handlers_["set_nickname"] = [this](auto session, const json &req)
-    { handle_set_nickname(session, req); };
-    request_handlers_["player_input"] = [this](auto session, const json &req)
-    { handle_player_input(session, req); };
-}
-
-void Server::broadcast_room_update(int room_id)
-{
-    if (active_rooms_.count(room_id) == 0)
+// --- Cross-shard hand-over ---
+// Rooms live on the shard that created them. A player joining a room on another shard moves there:
+// its record is handed to the target shard's strand first and the session is re-pointed second, so
+// the target has adopted the player before any later request from the session reaches it.
+
+int Server::shard_of_room(int room_id) const
+{
+    return room_id >= 0 ? room_id % shard_count_ : shard_index_;
+}
+
+// The room was created or its listing changed.
+void Server::publish_room(Room &room)
+{
+    ++room.listing_version;
+    ++rooms_version_;
+    if (lobby_)
+    {
+        lobby_->publish_room(room.id, room.name, room.player_count);
+    }
+}
+
+// Runs on the target shard's strand. A join of another shard's room starts here, so that the
+// player only leaves their current room once the room they asked for is sure to take them: a
+// stale room list entry leaves them where they are. The place is held until adopt_player() uses it.
+void Server::reserve_place(Server &origin, std::shared_ptr<Session> session, const JoinRoomRequest &join_request)
+{
+    auto it = active_rooms_.find(join_request.room_id);
+    if (it == active_rooms_.end())
         return;
 
-    Room &room = active_rooms_[room_id];
-    json room_update;
-    room_update["type"] = "update_room_info";
-    room_update["room_name"] = room.name;
-    room_update["host_id"] = room.host ? connected_players_[room.host].id : "";
+    ++it->second->player_count; // keeps the room open until the player arrives
+    publish_room(*it->second);
+    asio::post(origin.server_strand_, [&origin, target_shard = shard_index_, session = std::move(session), join_request]()
+               { origin.migrate_player(session, target_shard, join_request); });
+}
 
-    json players_array = json::array();
-    for (const auto &player_session : room.players)
+// The player held a place in the room (see reserve_place) and will not take it.
+void Server::release_place(int room_id)
+{
+    auto it = active_rooms_.find(room_id);
+    if (it == active_rooms_.end())
+        return;
+
+    auto room = it->second;
+    if (--room->player_count == 0)
     {
-        const auto &player_data = connected_players_[player_session];
-        json player_info;
-        player_info["player_id"] = player_data.id;
-        player_info["nickname"] = player_data.nickname;
-        player_info["is_ready"] = player_data.is_ready;
-        // Position data will be sent via game state updates, not here.
-        players_array.push_back(player_info);
+        active_rooms_.erase(it);
+        ++rooms_version_;
+        if (lobby_)
+            lobby_->remove_room(room->id);
     }
-    room_update["players"] = players_array;
+    else
+    {
+        publish_room(*room);
+    }
+}
 
-    std::string update_str = room_update.dump();
-    for (const auto &player_session : room.players)
+// The record moves once the room the player left has sent its last message to the session, so
+// that leave_room_success goes out before anything from the target shard. Until the target adopts
+// the player the session has no player, and requests that arrive meanwhile are dropped.
+void Server::migrate_player(std::shared_ptr<Session> session, int target_shard, const JoinRoomRequest &join_request)
+{
+    Server &target = lobby_->shard(target_shard);
+    const PlayerHandle handle = session->player();
+    if (!players_.get(handle))
     {
-        player_session->write(update_str);
+        // Disconnected, or already on its way elsewhere, since the place was reserved.
+        asio::post(target.server_strand_, [&target, room_id = join_request.room_id]()
+                   { target.release_place(room_id); });
+        return;
     }
-    std::cout << "broadcast_room_update" << std::endl;
+    auto room = leave_current_room(session, true);
+    session->set_player({});
+
+    after_room(std::move(room), [this, &target, session, handle, join_request]()
+               {
+        Player player = std::move(*players_.get(handle));
+        players_.erase(handle);
+        asio::post(target.server_strand_, [&target, session, player = std::move(player), join_request]() mutable
+                   { target.adopt_player(session, std::move(player), join_request); });
+        session->migrate_to(target); });
 }
 
-void Server::handle_set_nickname(std::shared_ptr<Session> session, const json &request)
+void Server::adopt_player(std::shared_ptr<Session> session, Player player, const JoinRoomRequest &join_request)
 {
-    std::string nickname = request["nickname"];
-    connected_players_[session].nickname = nickname;
-    std::cout << connected_players_[session].id << "'s nickname set " << nickname << std::endl;
+    const EntityId player_id = player.id;
+    const std::uint64_t udp_token = player.udp_token;
+    const PlayerHandle handle = players_.insert(std::move(player));
+    if (!handle)
+    {
+        std::cerr << "Player limit reached, dropping " << to_string(player_id) << std::endl;
+        udp_channel_.unregister_session(udp_token);
+        release_place(join_request.room_id);
+        return;
+    }
+    session->set_player(handle);
+    enter_room(active_rooms_.at(join_request.room_id), session, false, true);
 }
 
-void Server::handle_create_room(std::shared_ptr<Session> session, const json &request)
+// Runs `then` on server_strand_ after `room`'s strand has run everything posted to it so far, or
+// right away without a room.
+template <class Handler>
+void Server::after_room(std::shared_ptr<Room> room, Handler then)
 {
-    int room_id = next_room_id_++;
-    std::string room_name = request["room_name"];
+    if (!room)
+    {
+        then();
+        return;
+    }
+    asio::post(room->strand, [this, then = std::move(then)]() mutable
+               { asio::post(server_strand_, std::move(then)); });
+}
 
-    Room new_room;
-    new_room.id = room_id;
-    new_room.name = room_name;
-    new_room.players.push_back(session);
-    new_room.host = session;
-    active_rooms_[room_id] = new_room;
+// --- Membership ---
+// Lobby side runs on server_strand_, room side on the room's strand. The Player record is the
+// lobby's; the room works from the RoomMember it builds from a copy of it.
 
-    connected_players_[session].room_id = room_id;
-    broadcast_room_update(room_id);
-    std::cout << room_name << " Room is create from " << connected_players_[session].id << std::endl;
+// `reserved`: the player already holds a place in the room (see reserve_place).
+void Server::enter_room(std::shared_ptr<Room> room, std::shared_ptr<Session> session, bool as_host, bool reserved)
+{
+    Player *player = players_.get(session->player());
+    if (player->room_id != -1)
+    {
+        leave_current_room(session, false);
+    }
+    player->room_id = room->id;
+    if (!reserved)
+        room->player_count++;
+    session->set_room(room);
+    publish_room(*room);
+
+    RoomMember member;
+    member.session = session;
+    member.id = player->id;
+    member.udp_token = player->udp_token;
+    member.nickname = player->nickname;
+    asio::post(room->strand, [this, room, session = std::move(session), member = std::move(member), as_host]() mutable
+               {
+        vec3 position = {0, 0, 0};
+        if (as_host)
+        {
+            room->host = session;
+        }
+        else
+        {
+            // Set initial random position
+            std::uniform_real_distribution<float> spawn(-5.0f, 5.0f);
+            position = {spawn(room->rng), 0, spawn(room->rng)};
+        }
+        member.joined_tick = room->snapshot_tick;
+        room->players.push_back(std::move(member));
+        room->simulation.add(position);
+        broadcast_room_update(*room); });
 }
 
-void Server::handle_find_rooms(std::shared_ptr<Session> session, const json &request)
+// `notify` sends leave_room_success once the player is out of the room, on the room's ordered channel.
+// Returns the room left, if any, which may still be sending to the session.
+std::shared_ptr<Room> Server::leave_current_room(const std::shared_ptr<Session> &session, bool notify)
 {
-    json response;
-    response["type"] = "find_rooms_response";
-    json rooms_array = json::array();
-    for (auto const &[id, room] : active_rooms_)
+    Player *player = players_.get(session->player());
+    auto it = active_rooms_.find(player->room_id);
+    player->room_id = -1;
+    session->set_room(nullptr);
+    if (it == active_rooms_.end())
+        return nullptr;
+
+    auto room = it->second;
+    release_place(room->id);
+
+    asio::post(room->strand, [this, room, session, udp_token = player->udp_token, notify]()
+               {
+        if (RoomMember *member = find_member(*room, session))
+        {
+            const std::size_t index = static_cast<std::size_t>(member - room->players.data());
+            room->players.erase(room->players.begin() + static_cast<std::ptrdiff_t>(index));
+            room->simulation.remove(index);
+        }
+        if (!room->players.empty())
+        {
+            if (room->host == session)
+            {
+                room->host = room->players.front().session;
+            }
+            broadcast_room_update(*room);
+        }
+
+        if (notify)
+        {
+            // Same ordered channel as the room's updates, so none of them can arrive after it.
+            udp_channel_.send(udp_token, session, Channel::ReliableOrdered, make_outbound(LeaveRoomSuccessPayload{}));
+        } });
+    return room;
+}
+
+// --- Request Handler Implementations ---
+// Lobby handlers run on server_strand_ and room handlers on their room's strand, so no explicit
+// locking is needed.
+
+RoomMember *Server::find_member(Room &room, const std::shared_ptr<Session> &session)
+{
+    for (auto &member : room.players)
     {
-        json room_info;
-        room_info["room_id"] = room.id;
-        room_info["room_name"] = room.name;
-        room_info["player_count"] = room.players.size();
-        rooms_array.push_back(room_info);
+        if (member.session == session)
+        {
+            return &member;
+        }
     }
-    response["rooms"] = rooms_array;
-    session->write(response.dump());
-    std::cout << "finding room request" << std::endl;
+    return nullptr;
 }
 
-void Server::handle_join_room(std::shared_ptr<Session> session, const json &request)
+void Server::broadcast_room_update(Room &room)
 {
-    int room_id_to_join = request["room_id"];
-    if (active_rooms_.count(room_id_to_join))
+    // Assembled from each player's cached entry, for the encodings the members use; the framing
+    // is what encode_json() and encode_binary() write for an UpdateRoomInfoPayload.
+    RoomMember *host = room.host ? find_member(room, room.host) : nullptr;
+    const EntityId host_id = host ? host->id : EntityId{};
+
+    FragmentList players;
+    players.reserve(room.players.size());
+    for (auto &member : room.players)
+    {
+        // Position data will be sent via game state updates, not here.
+        players.push_back(member.info.refresh(member.version, PlayerInfo{member.id, member.nickname, member.is_ready}));
+    }
+
+    const OutboundMessage update_msg = make_outbound_message(MessageType::UpdateRoomInfo, [room_name = room.name, host_id, players = std::move(players)](Encoding encoding)
+                                                             {
+        std::string out;
+        if (encoding == Encoding::Schema)
+        {
+            append_binary(out, room_name);
+            append_binary(out, host_id);
+            append_fragment_list(out, encoding, players);
+            return out;
+        }
+        out.assign("{\"host_id\":");
+        append_json(out, host_id);
+        out.append(",\"players\":");
+        append_fragment_list(out, encoding, players);
+        out.append(",\"room_name\":");
+        append_json(out, room_name);
+        out.append(",\"type\":\"update_room_info\"}");
+        return out; });
+    for (const auto &member : room.players)
     {
-        active_rooms_[room_id_to_join].players.push_back(session);
-        connected_players_[session].room_id = room_id_to_join;
+        send_to(member, Channel::ReliableOrdered, update_msg);
+    }
+    std::cout << "broadcast_room_update" << std::endl;
+}
 
-        // Set initial random position
-        float x = static_cast<float>(rand()) / (static_cast<float>(RAND_MAX / 10.0f)) - 5.0f;
-        float z = static_cast<float>(rand()) / (static_cast<float>(RAND_MAX / 10.0f)) - 5.0f;
-        connected_players_[session].position = {x, 0, z};
+// Room events and snapshots go through the player's UDP channel, which falls back to TCP
+// until the client has bound an endpoint.
+void Server::send_to(const RoomMember &member, Channel channel, OutboundMessage msg)
+{
+    udp_channel_.send(member.udp_token, member.session, channel, std::move(msg));
+}
 
-        broadcast_room_update(room_id_to_join);
+void Server::handle_set_nickname(std::shared_ptr<Session> session, const SetNicknameRequest &request)
+{
+    std::string nickname = request.nickname;
+    Player *player = players_.get(session->player());
+    player->nickname = nickname;
+    if (auto room = session->room())
+    {
+        // The room keeps its own copy.
+        asio::post(room->strand, [room, session, nickname]()
+                   {
+            if (RoomMember *member = find_member(*room, session))
+            {
+                member->nickname = nickname;
+                ++member->version;
+            } });
     }
-    std::cout << connected_players_[session].id << " is join at" << active_rooms_[room_id_to_join].name << " Room" << std::endl;
+    std::cout << to_string(player->id) << "'s nickname set " << nickname << std::endl;
 }
 
-void Server::handle_chat_message(std::shared_ptr<Session> session, const json &request)
+// Only ever read from TCP: the challenge proves the endpoint it was sent to belongs to this session.
+void Server::handle_udp_confirm(std::shared_ptr<Session> session, const UdpConfirmRequest &request)
 {
-    int current_room_id = connected_players_[session].room_id;
-    if (current_room_id != -1)
+    Player *player = players_.get(session->player());
+    udp_channel_.confirm(player->udp_token, session, request.challenge);
+}
+
+void Server::handle_create_room(std::shared_ptr<Session> session, const CreateRoomRequest &request)
+{
+    int room_id = next_room_id_++ * shard_count_ + shard_index_;
+    std::string room_name = request.room_name;
+
+    auto new_room = std::make_shared<Room>(room_pool_, room_id, room_name, position_precision_);
+    active_rooms_[room_id] = new_room;
+    enter_room(new_room, session, true);
+    std::cout << room_name << " Room is create from " << to_string(players_.get(session->player())->id) << std::endl;
+}
+
+void Server::handle_find_rooms(std::shared_ptr<Session> session, const FindRoomsRequest &)
+{
+    if (lobby_)
     {
-        json broadcast_msg;
-        broadcast_msg["type"] = "chat_broadcast";
-        broadcast_msg["sender_id"] = connected_players_[session].nickname;
-        broadcast_msg["message"] = request["message"];
-        std::string broadcast_str = broadcast_msg.dump();
+        // Sharded: the directory knows the rooms of every shard.
+        lobby_->send_room_list(session);
+        return;
+    }
 
-        for (auto &player_session : active_rooms_[current_room_id].players)
+    // Rebuilt only after a room changed, and then only the changed rooms are re-serialized.
+    if (room_list_version_ != rooms_version_)
+    {
+        FragmentList rooms;
+        rooms.reserve(active_rooms_.size());
+        for (auto const &[id, room] : active_rooms_)
         {
-            player_session->write(broadcast_str);
+            rooms.push_back(room->listing.refresh(room->listing_version, RoomInfo{room->id, room->name, static_cast<int>(room->player_count)}));
         }
+        room_list_ = make_room_list(std::move(rooms));
+        room_list_version_ = rooms_version_;
     }
+    session->write(room_list_);
+    std::cout << "finding room request" << std::endl;
 }
 
-void Server::handle_leave_room(std::shared_ptr<Session> session, const json &request)
+void Server::handle_join_room(std::shared_ptr<Session> session, const JoinRoomRequest &request)
 {
-    int current_room_id = connected_players_[session].room_id;
+    int room_id_to_join = request.room_id;
+    if (shard_of_room(room_id_to_join) != shard_index_)
+    {
+        Server &target = lobby_->shard(shard_of_room(room_id_to_join));
+        asio::post(target.server_strand_, [this, &target, session, request]()
+                   { target.reserve_place(*this, session, request); });
+        return;
+    }
+    Player *player = players_.get(session->player());
+    auto it = active_rooms_.find(room_id_to_join);
+    if (it != active_rooms_.end() && player->room_id != room_id_to_join)
+    {
+        auto room = it->second;
+        enter_room(room, session, false);
+        std::cout << to_string(player->id) << " is join at" << room->name << " Room" << std::endl;
+    }
+}
+
+void Server::handle_leave_room(std::shared_ptr<Session> session, const LeaveRoomRequest &)
+{
+    Player *player = players_.get(session->player());
+    int current_room_id = player->room_id;
     if (current_room_id != -1)
     {
-        auto &room = active_rooms_[current_room_id];
-        room.players.erase(std::remove(room.players.begin(), room.players.end(), session), room.players.end());
-        connected_players_[session].room_id = -1;
+        auto it = active_rooms_.find(current_room_id);
+        std::string room_name = it != active_rooms_.end() ? it->second->name : "";
+        leave_current_room(session, true);
+        std::cout << to_string(player->id) << " is leave at" << room_name << " Room" << std::endl;
+    }
+}
 
-        if (room.players.empty())
-        {
-            active_rooms_.erase(current_room_id);
-        }
-        else
-        {
-            if (room.host == session)
-            {
-                room.host = room.players.front();
-            }
-            broadcast_room_update(current_room_id);
-        }
+void Server::handle_chat_message(Room &room, std::shared_ptr<Session> session, const ChatMessageRequest &request)
+{
+    RoomMember *sender = find_member(room, session);
+    if (!sender)
+        return;
 
-        json response;
-        response["type"] = "leave_room_success";
-        session->write(response.dump());
+    auto broadcast = make_outbound(ChatBroadcastPayload{sender->nickname, request.message});
+    for (auto &member : room.players)
+    {
+        send_to(member, Channel::ReliableOrdered, broadcast);
     }
-    std::cout << connected_players_[session].id << " is leave at" << active_rooms_[current_room_id].name << " Room" << std::endl;
 }
 
-void Server::handle_toggle_ready(std::shared_ptr<Session> session, const json &request)
+void Server::handle_toggle_ready(Room &room, std::shared_ptr<Session> session, const ToggleReadyRequest &)
 {
-    auto &player = connected_players_[session];
-    int current_room_id = player.room_id;
-    if (current_room_id != -1 && active_rooms_[current_room_id].host != session)
+    RoomMember *member = find_member(room, session);
+    if (member && room.host != session)
     {
-        player.is_ready = !player.is_ready;
-        broadcast_room_update(current_room_id);
+        member->is_ready = !member->is_ready;
+        ++member->version;
+        broadcast_room_update(room);
     }
 }
 
-void Server::handle_start_game(std::shared_ptr<Session> session, const json &request)
+void Server::handle_start_game(Room &room, std::shared_ptr<Session> session, const StartGameRequest &)
 {
-    // This logic remains largely the same, but within the strand
-    int current_room_id = connected_players_[session].room_id;
-    if (current_room_id != -1 && active_rooms_[current_room_id].host == session)
+    // This logic remains largely the same, but within the room's strand
+    if (find_member(room, session) && room.host == session)
     {
         // ... game start logic ...
     }
 }
 
-void Server::handle_player_input(std::shared_ptr<Session> session, const json &request)
+void Server::handle_player_input(Room &room, std::shared_ptr<Session> session, const PlayerInputRequest &request)
 {
     // IMPORTANT: This now only STORES the input. The game loop will process it.
-    auto &player = connected_players_[session];
-    if (player.room_id != -1)
+    RoomMember *member = find_member(room, session);
+    if (member)
     {
-        try
-        {
-            player.input_h = request.at("input").at("h").get<float>();
-            player.input_v = request.at("input").at("v").get<float>();
-            player.anim_forward = request.at("input").at("anim_forward").get<float>();
-            player.anim_strafe = request.at("input").at("anim_strafe").get<float>();
-        }
-        catch (json::exception &e)
-        {
-            std::cerr << "Error parsing player_input: " << e.what() << std::endl;
-        }
+        const std::size_t i = static_cast<std::size_t>(member - room.players.data());
+        RoomSimulation &simulation = room.simulation;
+        simulation.input_h[i] = request.input.h;
+        simulation.input_v[i] = request.input.v;
+        simulation.anim_forward[i] = request.input.anim_forward;
+        simulation.anim_strafe[i] = request.input.anim_strafe;
     }
 }
 
-void Server::start_game_loop()
+void Server::handle_snapshot_ack(Room &room, std::shared_ptr<Session> session, const SnapshotAckRequest &request)
 {
-    game_loop_timer_.expires_after(tick_interval_);
-    game_loop_timer_.async_wait([this](const asio::error_code &ec)
-                                {
-        if (!ec)
-        {
-            tick();
-        } });
+    // Acks can arrive out of order over UDP; only a newer snapshot moves the baseline. Ticks count
+    // per room, so a late ack for a snapshot of the player's previous room could name a tick this
+    // room has also sent; only ticks sent since the player joined are this room's.
+    RoomMember *member = find_member(room, session);
+    if (member && request.tick > member->acked_tick && request.tick > member->joined_tick && request.tick <= room.snapshot_tick)
+    {
+        member->acked_tick = request.tick;
+    }
 }
 
-void Server::tick()
+void Server::start_game_loop()
 {
-    // Post the game logic to the main server strand to ensure thread safety
     asio::post(server_strand_, [this]()
                {
-        float deltaTime = static_cast<float>(tick_interval_.count()) / 1000.0f;
-        const float speed = 5.0f;
+        next_tick_deadline_ = std::chrono::steady_clock::now() + tick_interval_;
+        schedule_tick(); });
+}
 
-        for (auto& [room_id, room] : active_rooms_)
+void Server::schedule_tick()
+{
+    game_loop_timer_.expires_at(next_tick_deadline_);
+    game_loop_timer_.async_wait(asio::bind_executor(server_strand_, [this](const asio::error_code &ec)
+                                                    {
+        if (!ec)
         {
-            if (room.players.empty()) continue;
+            tick();
+        } }));
+}
 
-            json all_players_state = json::array();
+void Server::tick()
+{
+    // Runs on server_strand_. The lobby strand only walks the directory; every room then
+    // simulates on its own strand, so rooms tick in parallel on the room pool, whose workers
+    // steal from each other until big and small rooms are spread evenly. The last room to
+    // finish closes the tick.
+    const auto now = std::chrono::steady_clock::now();
+    const auto lateness = now - next_tick_deadline_;
+    tick_stats_.total_lateness += lateness;
+    tick_stats_.max_lateness = std::max(tick_stats_.max_lateness, lateness);
+    tick_started_at_ = now;
+    next_tick_deadline_ += tick_interval_;
+
+    if (active_rooms_.empty())
+    {
+        finish_tick();
+        return;
+    }
 
-            // First, update all player positions based on their last input
-            for (auto& player_session : room.players)
-            {
-                if (connected_players_.count(player_session) == 0) continue;
+    rooms_ticking_.store(active_rooms_.size());
+    for (auto& [room_id, room] : active_rooms_)
+    {
+        asio::post(room->strand, [this, room]()
+                   {
+            // A room that throws still counts as done, or the tick would never finish.
+            ScopeExit done{[this]()
+                           {
+                if (rooms_ticking_.fetch_sub(1) == 1)
+                {
+                    asio::post(server_strand_, [this]()
+                               { finish_tick(); });
+                } }};
+            tick_room(*room); });
+    }
+}
 
-                auto& player = connected_players_[player_session];
+void Server::finish_tick()
+{
+    const auto now = std::chrono::steady_clock::now();
+    const auto duration = now - tick_started_at_;
+    tick_stats_.total_duration += duration;
+    tick_stats_.max_duration = std::max(tick_stats_.max_duration, duration);
+    if (duration > tick_interval_) ++tick_stats_.overruns;
+    if (++tick_stats_.ticks % kTickStatsPeriod == 0) report_tick_stats();
+
+    if (now < next_tick_deadline_)
+    {
+        schedule_tick();
+        return;
+    }
 
-                // Calculate movement
-                vec3 direction = { player.input_h, 0, player.input_v };
-                float length = std::sqrt(direction.x * direction.x + direction.z * direction.z);
-                if (length > 0.01f)
-                {
-                    direction.x /= length;
-                    direction.z /= length;
-                }
-
-                player.position.x += direction.x * speed * deltaTime;
-                player.position.z += direction.z * speed * deltaTime;
-
-                // Create JSON object for this player's state
-                json player_state;
-                player_state["player_id"] = player.id;
-                
-                json pos_json;
-                pos_json["x"] = player.position.x;
-                pos_json["y"] = player.position.y;
-                pos_json["z"] = player.position.z;
-                player_state["position"] = pos_json;
-
-                json anim_json;
-                anim_json["forward"] = player.anim_forward;
-                anim_json["strafe"] = player.anim_strafe;
-                player_state["animation"] = anim_json;
-
-                all_players_state.push_back(player_state);
-            }
+    // Behind schedule: `due` deadlines have already passed.
+    const auto due = (now - next_tick_deadline_) / tick_interval_ + 1;
+    if (due > kMaxCatchUpTicks)
+    {
+        // Drop all but the most recent deadline, keeping the original phase.
+        next_tick_deadline_ += (due - 1) * tick_interval_;
+        tick_stats_.skipped += due - 1;
+    }
+    tick();
+}
 
-            // Then, broadcast the complete game state to all players in the room
-            json game_state_update;
-            game_state_update["type"] = "game_state_update";
-            game_state_update["players"] = all_players_state;
-            std::string state_str = game_state_update.dump();
+void Server::report_tick_stats()
+{
+    using ms = std::chrono::duration<double, std::milli>;
+    const auto ticks = static_cast<double>(kTickStatsPeriod);
+    std::cout << "tick stats: lateness avg " << ms(tick_stats_.total_lateness).count() / ticks
+              << "ms max " << ms(tick_stats_.max_lateness).count()
+              << "ms, duration avg " << ms(tick_stats_.total_duration).count() / ticks
+              << "ms max " << ms(tick_stats_.max_duration).count()
+              << "ms, overruns " << tick_stats_.overruns
+              << ", skipped " << tick_stats_.skipped << std::endl;
+    tick_stats_ = TickStats{tick_stats_.ticks};
+}
 
-            for (auto& player_session : room.players)
-            {
-                player_session->write(state_str);
-            }
-        } });
+void Server::tick_room(Room &room)
+{
+    room.inputs.drain([&](QueuedInput &input)
+                      { handle_player_input(room, std::move(input.session), input.request); });
+    if (room.players.empty()) return;
+
+    float deltaTime = static_cast<float>(tick_interval_.count()) / 1000.0f;
+    const float speed = 5.0f;
+
+    // First, update all player positions based on their last input
+    RoomSimulation& simulation = room.simulation;
+    advance_positions(simulation, speed * deltaTime);
+
+    // The snapshot is written straight into one of the room's reusable buffers, which then goes
+    // out as is. The JSON framing around the players is what encode_json() writes for a
+    // GameStateUpdatePayload, so clients see the same bytes as before. The quantized state goes
+    // into the history that Encoding::Schema deltas are encoded against.
+    const std::shared_ptr<std::string> json_buffer = room.snapshot_buffers.acquire();
+    std::string& snapshot_json = *json_buffer;
+    snapshot_json.assign("{\"players\":[");
+    SnapshotFrame& frame = room.snapshot_history.push(++room.snapshot_tick);
+    for (std::size_t i = 0; i < room.players.size(); ++i)
+    {
+        const PlayerState state{room.players[i].id,
+                                {simulation.x[i], simulation.y[i], simulation.z[i]},
+                                {simulation.anim_forward[i], simulation.anim_strafe[i]}};
+        if (i != 0)
+        {
+            snapshot_json.push_back(',');
+        }
+        append_json(snapshot_json, state);
+        frame.players.push_back({state.player_id, room.quantizer.quantize(state.position), quantize(state.animation)});
+    }
+    snapshot_json.append("],\"type\":\"game_state_update\"}");
+
+    // Then, broadcast the game state to all players in the room. JSON clients share the full
+    // snapshot; binary ones get a delta against their own baseline, shared by every member
+    // that acked the same tick.
+    const SharedMessage json_text = json_buffer;
+    auto& deltas = room.snapshot_deltas;
+    for (auto& member : room.players)
+    {
+        const SnapshotFrame* baseline = room.snapshot_history.find(member.acked_tick);
+        const std::uint32_t baseline_tick = baseline ? baseline->tick : 0;
+        auto delta = std::find_if(deltas.begin(), deltas.end(), [&](const auto& entry)
+                                  { return entry.first == baseline_tick; });
+        if (delta == deltas.end())
+        {
+            std::shared_ptr<std::string> bytes = room.snapshot_buffers.acquire();
+            append_snapshot_delta(*bytes, room.quantizer, frame, baseline);
+            delta = deltas.insert(deltas.end(), {baseline_tick, std::move(bytes)});
+        }
 
-    // Schedule the next tick
-    start_game_loop();
+        // A late snapshot is useless once a newer one arrived.
+        send_to(member, Channel::UnreliableSequenced, make_outbound_message(MessageType::GameStateUpdate, json_text, delta->second));
+    }
+    deltas.clear(); // lets the buffers go back to the pool once the sessions are done with them
 }
@@ -1,8 +1,16 @@
 #pragma once
 
 #include "stdafx.h"
-#include "Player.h"
+#include "PlayerRegistry.h"
 #include "Room.h"
+#include "Protocol.h"
+#include "Schema.h"
+#include "Message.h"
+#include "UdpChannel.h"
+#include "LobbyDirectory.h"
+#include "SendBudget.h"
+#include "JsonArena.h"
+#include "WorkStealingPool.h"
 
 // Forward declaration of Session class
 class Session;
@@ -10,52 +18,140 @@ class Session;
 class Server
 {
 public:
-    Server(asio::io_context& io_context, short port);
+    // `room_threads` workers run the rooms; 0 picks one per core.
+    Server(asio::io_context& io_context, unsigned short port, std::size_t room_threads = 0);
+    // One shard of a ShardedServer: its own SO_REUSEPORT acceptor, UDP channel, sessions and players
+    // on `io_context`, with the lobby directory and room pool shared between shards.
+    Server(asio::io_context& io_context, unsigned short port, UdpChannel& udp_channel, LobbyDirectory& lobby, WorkStealingPool& room_pool, int shard_index);
     void run();
+    void start(); // begins accepting and ticking; the caller runs the io_context
+    void set_send_budget(SendBudget budget) { send_budget_ = budget; } // applies to sessions accepted afterwards
+    void set_position_precision(float precision) { position_precision_ = precision; } // applies to rooms created afterwards
 
-    // Game Loop
+    // Game Loop. Ticks fire on absolute deadlines tick_interval_ apart; a tick that is
+    // still running when the next deadline passes delays it rather than overlapping it.
     void start_game_loop();
     void tick();
 
     // Interface for Session class to interact with the server
     void handle_connect(std::shared_ptr<Session> session);
     void handle_disconnect(std::shared_ptr<Session> session);
-    void handle_request(std::shared_ptr<Session> session, const std::string& message);
+    void handle_request(std::shared_ptr<Session> session, MessageType type, std::string_view message);
 
 private:
+    // Cross-shard hand-over
+    void reserve_place(Server& origin, std::shared_ptr<Session> session, const JoinRoomRequest& join_request);
+    void release_place(int room_id);
+    void migrate_player(std::shared_ptr<Session> session, int target_shard, const JoinRoomRequest& join_request);
+    void adopt_player(std::shared_ptr<Session> session, Player player, const JoinRoomRequest& join_request);
+    template <class Handler>
+    void after_room(std::shared_ptr<Room> room, Handler then);
+    int shard_of_room(int room_id) const;
+    void publish_room(Room& room);
+
+    static std::size_t io_thread_count();
     void start_accept();
     void handle_accept(tcp::socket socket, const asio::error_code& error);
 
     // Request Handlers
-    void initialize_request_handlers();
-    void handle_create_room(std::shared_ptr<Session> session, const json& req);
-    void handle_find_rooms(std::shared_ptr<Session> session, const json& req);
-    void handle_join_room(std::shared_ptr<Session> session, const json& req);
-    void handle_chat_message(std::shared_ptr<Session> session, const json& req);
-    void handle_leave_room(std::shared_ptr<Session> session, const json& req);
-    void handle_toggle_ready(std::shared_ptr<Session> session, const json& req);
-    void handle_start_game(std::shared_ptr<Session> session, const json& req);
-    void handle_set_nickname(std::shared_ptr<Session> session, const json& req);
-    void handle_player_input(std::shared_ptr<Session> session, const json& req);
-
-    // Utility
-    void broadcast_room_update(int room_id);
+    // A request as it arrived: a parsed JSON object, or a payload in Encoding::Schema.
+    struct EncodedRequest
+    {
+        const request_json* object = nullptr;
+        std::string_view bytes;
+    };
+    // One entry per request id, built at compile time from the handler list in Server.cpp.
+    using RequestDispatcher = void (Server::*)(std::shared_ptr<Session>, const EncodedRequest&);
+    using RequestTable = std::array<RequestDispatcher, kRequestTypeCount>;
+
+    static constexpr RequestTable make_request_table();
+    template <auto Handler>
+    static constexpr void add_handler(RequestTable& table);
+    template <auto Handler>
+    void dispatch(std::shared_ptr<Session> session, const EncodedRequest& encoded);
+    template <class Request>
+    void post_room_request(std::shared_ptr<Session> session, void (Server::*handler)(Room&, std::shared_ptr<Session>, const Request&), Request request);
+    void queue_player_input(std::shared_ptr<Session> session, const PlayerInputRequest& request) const; // on the receiving thread
+
+    // Lobby requests, run on server_strand_
+    void handle_create_room(std::shared_ptr<Session> session, const CreateRoomRequest& req);
+    void handle_find_rooms(std::shared_ptr<Session> session, const FindRoomsRequest& req);
+    void handle_join_room(std::shared_ptr<Session> session, const JoinRoomRequest& req);
+    void handle_leave_room(std::shared_ptr<Session> session, const LeaveRoomRequest& req);
+    void handle_set_nickname(std::shared_ptr<Session> session, const SetNicknameRequest& req);
+    void handle_udp_confirm(std::shared_ptr<Session> session, const UdpConfirmRequest& req);
+
+    // Room requests, run on the room's strand
+    void handle_chat_message(Room& room, std::shared_ptr<Session> session, const ChatMessageRequest& req);
+    void handle_toggle_ready(Room& room, std::shared_ptr<Session> session, const ToggleReadyRequest& req);
+    void handle_start_game(Room& room, std::shared_ptr<Session> session, const StartGameRequest& req);
+    void handle_player_input(Room& room, std::shared_ptr<Session> session, const PlayerInputRequest& req); // queued, applied by tick_room
+    void handle_snapshot_ack(Room& room, std::shared_ptr<Session> session, const SnapshotAckRequest& req);
+
+    // Membership: the lobby updates the directory, then posts the change to the room's strand
+    void enter_room(std::shared_ptr<Room> room, std::shared_ptr<Session> session, bool as_host, bool reserved = false);
+    std::shared_ptr<Room> leave_current_room(const std::shared_ptr<Session>& session, bool notify);
+    void tick_room(Room& room);
+
+    // Tick scheduling, all on server_strand_
+    void schedule_tick();
+    void finish_tick();
+    void report_tick_stats();
+
+    // Utility (room strand)
+    void broadcast_room_update(Room& room);
+    void send_to(const RoomMember& member, Channel channel, OutboundMessage msg);
+    static RoomMember* find_member(Room& room, const std::shared_ptr<Session>& session);
 
     tcp::acceptor acceptor_;
+    std::unique_ptr<UdpChannel> owned_udp_channel_; // null when the ShardedServer owns the channel
+    UdpChannel& udp_channel_; // game_state_update / player_input, bound to the same port
+    std::unique_ptr<WorkStealingPool> owned_room_pool_; // null when the pool is shared between shards
+    WorkStealingPool& room_pool_; // runs every room's strand, ticks included
+
+    // Sharding. A standalone server is shard 0 of 1 with no lobby directory.
+    LobbyDirectory* lobby_ = nullptr;
+    const int shard_index_ = 0;
+    const int shard_count_ = 1;
     asio::io_context& io_context_;
+    SendBudget send_budget_;
+    float position_precision_ = kDefaultPositionPrecision;
     asio::steady_timer game_loop_timer_;
     const std::chrono::milliseconds tick_interval_{50}; // 20 ticks per second
+
+    // A tick that finishes behind schedule starts the next one immediately, up to
+    // kMaxCatchUpTicks behind; beyond that the missed ticks are dropped so the loop
+    // returns to its original phase instead of bursting.
+    static constexpr int kMaxCatchUpTicks = 3;
+    static constexpr std::uint64_t kTickStatsPeriod = 20 * 60; // ticks between reports
+
+    struct TickStats
+    {
+        std::uint64_t ticks = 0;
+        std::uint64_t overruns = 0; // ticks that took longer than tick_interval_
+        std::uint64_t skipped = 0;  // deadlines dropped instead of caught up
+        std::chrono::steady_clock::duration total_lateness{}, max_lateness{};
+        std::chrono::steady_clock::duration total_duration{}, max_duration{};
+    };
+
+    std::chrono::steady_clock::time_point next_tick_deadline_;
+    std::chrono::steady_clock::time_point tick_started_at_;
+    std::atomic<std::size_t> rooms_ticking_{0};
+    TickStats tick_stats_;
     
-    // Use a single strand for managing shared resources like rooms and players
-    // This is a simpler approach than per-room mutexes for now.
+    // The lobby strand owns the directory: which players are connected and which rooms exist,
+    // and their Player records. Room state, members included, lives behind each room's own
+    // strand (see Room.h).
     asio::strand<asio::io_context::executor_type> server_strand_;
 
-    std::map<int, Room> active_rooms_;
-    std::map<std::shared_ptr<Session>, Player> connected_players_;
+    std::map<int, std::shared_ptr<Room>> active_rooms_;
+    std::uint64_t rooms_version_ = 1;      // bumped whenever a room is listed, delisted or changes
+    std::uint64_t room_list_version_ = 0;  // rooms_version_ that room_list_ was built at
+    OutboundMessage room_list_;            // find_rooms_response, reused while nothing changed
+    PlayerRegistry players_;               // every player of this shard; sessions hold their handles
     std::atomic<int> next_room_id_{0};
     std::atomic<int> next_player_id_num_{0};
 
     std::vector<std::thread> thread_pool_;
-    std::map<std::string, std::function<void(std::shared_ptr<Session>, const json&)>> request_handlers_;
 };
 
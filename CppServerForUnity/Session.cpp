@@ -1,53 +1,369 @@
 #include "Session.h"
 #include "Server.h"
 
-Session::Session(tcp::socket socket, Server &server)
-    : socket_(std::move(socket)), server_(server), strand_(socket_.get_executor()) {}
+Session::Session(tcp::socket socket, Server &server, SendBudget budget)
+    : socket_(std::move(socket)), server_(&server), strand_(socket_.get_executor()), budget_(budget) {}
 
 void Session::start()
 {
     // 서버에 새로운 세션이 시작됐음을 알려준다.
-    server_.handle_connect(shared_from_this());
+    server().handle_connect(shared_from_this());
     do_read();
 }
 
+// Reads whatever the socket has into the tail of recv_buffer_ and dispatches every complete
+// frame in it. Frames are passed to the server as views into the buffer; nothing is copied out.
 void Session::do_read()
 {
     auto self = shared_from_this();
-    asio::async_read_until(socket_, buffer_, "\n", asio::bind_executor(strand_, [this, self](const asio::error_code &ec, std::size_t length)
-                                                                       {
-    if (!ec)
+    socket_.async_read_some(recv_buffer_.prepare(std::max(kReadChunk, bytes_wanted_)), asio::bind_executor(strand_, [this, self](const asio::error_code &ec, std::size_t length)
+                                                                                                       {
+    if (ec)
+    {
+        report_disconnect();
+        return;
+    }
+
+    recv_buffer_.commit(length);
+    if (!process_frames())
+    {
+        socket_.close();
+        report_disconnect();
+        return;
+    }
+    do_read(); // Continue reading the next message
+    }));
+}
+
+// Returns false when the peer sent something that cannot be framed and must be dropped.
+bool Session::process_frames()
+{
+    // Negotiation can switch the framing in the middle of a read, so re-dispatch until
+    // the active mode has consumed all it can.
+    Framing framing;
+    do
+    {
+        framing = framing_;
+        if (!(framing == Framing::Binary ? process_binary_frames() : process_lines()))
+        {
+            return false;
+        }
+    } while (framing != framing_);
+    return true;
+}
+
+bool Session::process_lines()
+{
+    auto self = shared_from_this();
+    while (framing_ == Framing::Newline)
+    {
+        std::string_view pending = recv_buffer_.data();
+        const std::size_t pos = pending.find(kDelimiter, scan_offset_);
+        if (pos == std::string_view::npos)
+        {
+            // Only the new bytes are searched next time.
+            scan_offset_ = pending.size();
+            return pending.size() <= kMaxFrameSize;
+        }
+
+        std::string_view message = pending.substr(0, pos);
+        if (!message.empty() && message.back() == '\r')
+        {
+            message.remove_suffix(1);
+        }
+
+        if (!framing_negotiated_)
+        {
+            framing_negotiated_ = true;
+            if (negotiate(message))
+            {
+                recv_buffer_.consume(pos + 1);
+                scan_offset_ = 0;
+                return true;
+            }
+        }
+
+        server().handle_request(self, MessageType::Unknown, message);
+        recv_buffer_.consume(pos + 1);
+        scan_offset_ = 0;
+    }
+    return true;
+}
+
+bool Session::process_binary_frames()
+{
+    auto self = shared_from_this();
+    bytes_wanted_ = 0;
+    while (recv_buffer_.size() >= kFrameHeaderSize)
     {
-        std::istream is(&buffer_);
-        std::string message(std::istreambuf_iterator<char>(is), {});
-        // The message includes the delimiter, so we might want to remove it
-        message.pop_back(); // Remove '\n'
+        std::string_view pending = recv_buffer_.data();
+        std::uint32_t frame_length = 0;
+        MessageType frame_type = MessageType::Unknown;
+        bool compressed = false;
+        decode_frame_header(reinterpret_cast<const std::uint8_t *>(pending.data()), frame_length, frame_type, compressed);
+        if (frame_length > kMaxFrameSize)
+        {
+            std::cerr << "Frame too large: " << frame_length << " bytes" << std::endl;
+            return false;
+        }
 
-        server_.handle_request(self, message);
-        do_read(); // Continue reading the next message
+        if (pending.size() < kFrameHeaderSize + frame_length)
+        {
+            // Make sure the next read has room for the rest of the frame.
+            bytes_wanted_ = kFrameHeaderSize + frame_length - pending.size();
+            break;
+        }
+
+        std::string_view payload = pending.substr(kFrameHeaderSize, frame_length);
+        if (compressed)
+        {
+            if (!compression_ || !decompress_frame(payload, inflated_, kMaxFrameSize))
+            {
+                std::cerr << "Malformed compressed frame" << std::endl;
+                return false;
+            }
+            payload = inflated_;
+        }
+        server().handle_request(self, frame_type, payload);
+        recv_buffer_.consume(kFrameHeaderSize + frame_length);
+    }
+    return true;
+}
+
+// Runs on strand_. Switches to binary framing if `line` is a framing hello and returns whether it
+// was. The acknowledgement is still newline framed; everything queued after it is binary and in
+// the negotiated encoding. Capabilities the server does not know are left out of the answer.
+bool Session::negotiate(std::string_view line)
+{
+    const std::string_view hello = line.substr(0, line.find(' '));
+    if (hello != kBinaryFramingHello && hello != kSchemaEncodingHello)
+    {
+        return false;
+    }
+
+    std::string answer(hello);
+    bool compression = false;
+    for (std::size_t begin = hello.size(); begin < line.size();)
+    {
+        const std::size_t end = std::min(line.find(' ', begin + 1), line.size());
+        const std::string_view capability = line.substr(begin + 1, end - begin - 1);
+        if (capability == kCompressionCapability && !compression)
+        {
+            compression = true;
+            answer.append(" ").append(capability);
+        }
+        begin = end;
+    }
+
+    enqueue(MessageType::Unknown, make_message(std::move(answer)));
+    framing_ = Framing::Binary;
+    encoding_ = hello == kSchemaEncodingHello ? Encoding::Schema : Encoding::Json;
+    compression_ = compression;
+    return true;
+}
+
+// Runs on strand_. The framing is fixed when the message is queued, so a switch never re-frames
+// messages that were queued before it.
+void Session::enqueue(MessageType type, SharedMessage msg, bool compressed)
+{
+    if (closed_ || !admit(type, msg->size()))
+    {
+        return;
+    }
+
+    auto frame = make_frame(type, std::move(msg), compressed);
+    pending_bytes_ += frame.payload->size();
+    if (type == MessageType::GameStateUpdate)
+    {
+        // Latest wins: a snapshot still waiting to go out is stale once a newer one arrives.
+        if (latest_snapshot_)
+        {
+            pending_bytes_ -= latest_snapshot_->payload->size();
+        }
+        latest_snapshot_ = std::move(frame);
     }
     else
     {
-        server_.handle_disconnect(self);
-    } }));
+        write_queue_.push_back(std::move(frame));
+    }
+
+    if (!write_in_progress_)
+    {
+        do_write();
+    }
 }
 
-void Session::do_write(const std::string &msg)
+// Runs on strand_. Applies the send budget to a message about to be queued and returns whether
+// to queue it. Under DegradeRate an over-budget session only takes every snapshot_stride_-th
+// snapshot; the stride recovers as writes complete (see do_write).
+bool Session::admit(MessageType type, std::size_t size)
 {
+    const bool snapshot = type == MessageType::GameStateUpdate;
+    if (snapshot && ++snapshot_counter_ % snapshot_stride_ != 0)
+    {
+        return false;
+    }
+
+    std::size_t pending = pending_bytes_;
+    if (snapshot && latest_snapshot_)
+    {
+        pending -= latest_snapshot_->payload->size(); // it would be replaced
+    }
+    if (pending + size <= budget_.max_pending_bytes)
+    {
+        return true;
+    }
+
+    switch (budget_.policy)
+    {
+    case SlowConsumerPolicy::Drop:
+        return false;
+    case SlowConsumerPolicy::DegradeRate:
+        snapshot_stride_ = std::min(snapshot_stride_ * 2, kMaxSnapshotStride);
+        if (snapshot)
+        {
+            return false;
+        }
+        // Lobby and room messages are not optional; keep them until the hard limit.
+        if (pending + size <= 2 * budget_.max_pending_bytes)
+        {
+            return true;
+        }
+        break;
+    case SlowConsumerPolicy::Disconnect:
+        break;
+    }
+    close();
+    return false;
+}
+
+Session::OutboundFrame Session::make_frame(MessageType type, SharedMessage msg, bool compressed) const
+{
+    OutboundFrame frame{std::move(msg), {}, framing_};
+    if (framing_ == Framing::Binary)
+    {
+        frame.header = encode_frame_header(type, static_cast<std::uint32_t>(frame.payload->size()), compressed);
+    }
+    return frame;
+}
+
+// Runs on strand_. Drops a client that cannot keep up. The read and write in flight fail with
+// operation_aborted and find the disconnect already reported.
+void Session::close()
+{
+    std::cout << "closing slow session with " << pending_bytes_ << " bytes pending" << std::endl;
+    write_queue_.clear();
+    latest_snapshot_.reset();
+    asio::error_code ignored;
+    socket_.shutdown(tcp::socket::shutdown_both, ignored);
+    socket_.close(ignored);
+    report_disconnect();
+}
+
+// Drains everything queued so far with a single gather write.
+// Newline frames get a one-byte delimiter buffer and binary frames their header buffer,
+// so payloads are never concatenated with their framing.
+void Session::do_write()
+{
+    write_in_progress_ = true;
+    sending_.clear();
+    write_buffers_.clear();
+    while (!write_queue_.empty())
+    {
+        sending_.push_back(std::move(write_queue_.front()));
+        write_queue_.pop_front();
+    }
+    if (latest_snapshot_)
+    {
+        sending_.push_back(std::move(*latest_snapshot_));
+        latest_snapshot_.reset();
+    }
+    sending_bytes_ = 0;
+    for (const auto &frame : sending_)
+    {
+        sending_bytes_ += frame.payload->size();
+        if (frame.framing == Framing::Binary)
+        {
+            write_buffers_.push_back(asio::buffer(frame.header));
+            write_buffers_.push_back(asio::buffer(*frame.payload));
+        }
+        else
+        {
+            write_buffers_.push_back(asio::buffer(*frame.payload));
+            write_buffers_.push_back(asio::buffer(&kDelimiter, 1));
+        }
+    }
+
     auto self = shared_from_this();
-    auto buffer = std::make_shared<std::string>(msg + "\n");
-    asio::async_write(socket_, asio::buffer(*buffer), asio::bind_executor(strand_, [this, self, buffer](const asio::error_code &ec, std::size_t /*length*/)
-                                                                          {
+    asio::async_write(socket_, write_buffers_, asio::bind_executor(strand_, [this, self](const asio::error_code &ec, std::size_t /*length*/)
+                                                                   {
     if (ec)
     {
-        server_.handle_disconnect(self);
+        write_in_progress_ = false;
+        write_queue_.clear();
+        latest_snapshot_.reset();
+        report_disconnect();
+        return;
+    }
+
+    pending_bytes_ -= sending_bytes_;
+    if (snapshot_stride_ > 1 && pending_bytes_ < budget_.max_pending_bytes / 2)
+    {
+        snapshot_stride_ /= 2;
+    }
+
+    // Messages queued while this batch was in flight go out in the next one.
+    if (!write_queue_.empty() || latest_snapshot_)
+    {
+        do_write();
+    }
+    else
+    {
+        write_in_progress_ = false;
     } }));
 }
 
 // This public-facing write function can be called from outside the Session class
-// It posts the actual write operation to the strand to maintain thread safety.
-void Session::write(const std::string &msg)
+// It posts the message to the strand, where it is queued behind any in-flight write.
+// The payload is shared, so broadcasting one message to many sessions never copies it; nor is it
+// compressed more than once.
+void Session::write(OutboundMessage msg)
+{
+    asio::post(strand_, [this, self = shared_from_this(), msg = std::move(msg)]()
+               {
+        const Encoding encoding = encoding_;
+        if (compression_ && msg.type != MessageType::GameStateUpdate)
+        {
+            if (SharedMessage packed = msg.compressed_payload(encoding))
+            {
+                enqueue(msg.type, std::move(packed), true);
+                return;
+            }
+        }
+        enqueue(msg.type, msg.payload(encoding)); });
+}
+
+// Runs on strand_. Read and write failures both end up here; the server hears about it once.
+void Session::report_disconnect()
+{
+    if (closed_)
+    {
+        return;
+    }
+    closed_ = true;
+    server().handle_disconnect(shared_from_this());
+}
+
+// Re-points the session at the shard that now owns its player. Requests read after this runs go
+// to the new shard. A disconnect that was already reported to the old shard, which no longer
+// knows the player, is reported again to the new one.
+void Session::migrate_to(Server &server)
 {
-    asio::post(strand_, [this, self = shared_from_this(), msg]()
-               { do_write(msg); });
+    asio::post(strand_, [this, self = shared_from_this(), target = &server]()
+               {
+        server_ = target;
+        if (closed_)
+        {
+            target->handle_disconnect(self);
+        } });
 }
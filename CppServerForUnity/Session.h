@@ -1,24 +1,90 @@
-
 #pragma once
 
 #include "stdafx.h"
+#include <optional>
 #include "Server.h"
+#include "Message.h"
+#include "PlayerRegistry.h"
+#include "Protocol.h"
+#include "RecvBuffer.h"
+#include "SendBudget.h"
 
 class Server; // 전방선언
 
 class Session : public std::enable_shared_from_this<Session> // 비동기 콜백에서 shared_ptr를 안전하게 사용하기 위해 상속받는다.
 {
 public:
-    Session(tcp::socket socket, Server &server);
+    Session(tcp::socket socket, Server &server, SendBudget budget = {});
     void start();
-    void write(const std::string &msg);
+    void write(OutboundMessage msg); // queues the payload matching the session's encoding
+
+    // 협상된 페이로드 인코딩. UDP 채널이 어느 스레드에서든 읽는다.
+    Encoding encoding() const { return encoding_.load(); }
+
+    // 세션을 담당하는 서버(샤드). 다른 샤드의 방에 입장하면 바뀐다.
+    Server &server() const { return *server_.load(); }
+    void migrate_to(Server &server);
+
+    // 세션의 플레이어. 담당 서버의 로비 strand가 정하고, 그 서버의 PlayerRegistry에서만 의미가 있다.
+    PlayerHandle player() const { return player_.load(); }
+    void set_player(PlayerHandle player) { player_.store(player); }
+
+    // 현재 입장한 방. 로비 strand에서 바뀌고, 방 요청을 보낼 strand를 고를 때 어느 스레드에서든 읽힌다.
+    std::shared_ptr<Room> room() const { return std::atomic_load(&room_); }
+    void set_room(std::shared_ptr<Room> room) { std::atomic_store(&room_, std::move(room)); }
 
 private:
+    // 송신 대기 중인 프레임. 헤더는 바이너리 프레이밍일 때만 사용한다.
+    struct OutboundFrame
+    {
+        SharedMessage payload;
+        FrameHeader header;
+        Framing framing;
+    };
+
     void do_read();
-    void do_write(const std::string &msg);
+    bool process_frames();
+    bool process_lines();
+    bool process_binary_frames();
+    bool negotiate(std::string_view line);
+    void enqueue(MessageType type, SharedMessage msg, bool compressed = false);
+    bool admit(MessageType type, std::size_t size);
+    OutboundFrame make_frame(MessageType type, SharedMessage msg, bool compressed) const;
+    void do_write();
+    void close();
+    void report_disconnect();
+
+    static constexpr char kDelimiter = '\n';   // 메시지 구분자
+    static constexpr std::size_t kReadChunk = 4096; // 한 번의 read_some에 확보할 최소 공간
+    static constexpr unsigned kMaxSnapshotStride = 8;  // DegradeRate에서 최소 1/8 비율로는 스냅샷을 보낸다
 
     tcp::socket socket_;                         // 소켓
-    asio::streambuf buffer_;                     // 데이터 버퍼
-    Server &server_;                             // 참조할 서버
+    RecvBuffer recv_buffer_;                     // 수신 버퍼
+    std::size_t scan_offset_ = 0;                // 구분자를 이미 찾아본 위치 (newline 모드)
+    std::size_t bytes_wanted_ = 0;               // 다음 프레임 완성에 필요한 바이트 (binary 모드)
+    std::atomic<Server *> server_;               // 참조할 서버
+    bool closed_ = false;                        // 연결 종료를 이미 서버에 알렸는지
+    std::shared_ptr<Room> room_;                 // atomic_load/atomic_store로만 접근
+    std::atomic<PlayerHandle> player_{};         // 샤드를 옮기는 동안에는 null
     asio::strand<asio::any_io_executor> strand_; // 스트랜드
+
+    Framing framing_ = Framing::Newline;         // 현재 프레이밍 방식
+    bool framing_negotiated_ = false;            // 첫 메시지에서만 협상 가능
+    std::atomic<Encoding> encoding_{Encoding::Json}; // 프레이밍과 함께 협상된다
+    bool compression_ = false;                   // 압축 프레임 허용 여부 (FrameCompression.h). strand_ 안에서만 접근한다.
+    std::string inflated_;                       // 압축 해제한 수신 프레임
+
+    // 송신 큐. strand_ 안에서만 접근한다.
+    std::deque<OutboundFrame> write_queue_;      // 다음 flush를 기다리는 프레임
+    std::vector<OutboundFrame> sending_;         // 현재 async_write 중인 프레임 묶음
+    std::vector<asio::const_buffer> write_buffers_; // sending_ + 구분자/헤더의 gather 목록
+    bool write_in_progress_ = false;             // async_write는 항상 하나만 진행
+
+    // 느린 클라이언트 처리. strand_ 안에서만 접근한다.
+    SendBudget budget_;                          // 미전송 바이트 한도와 초과 시 정책
+    std::optional<OutboundFrame> latest_snapshot_; // 아직 보내지 않은 최신 game_state_update 하나
+    std::size_t pending_bytes_ = 0;              // write_queue_ + latest_snapshot_ + sending_ 크기
+    std::size_t sending_bytes_ = 0;              // 그중 sending_ 크기
+    unsigned snapshot_stride_ = 1;               // N개 스냅샷 중 하나만 보낸다
+    unsigned snapshot_counter_ = 0;
 };
@@ -0,0 +1,77 @@
+#include "ShardedServer.h"
+
+ShardedServer::ShardedServer(unsigned short port, int shard_count, std::size_t room_threads)
+{
+    // Player handles carry their shard's index (see PlayerRegistry.h).
+    shard_count = std::clamp(shard_count, 1, static_cast<int>(PlayerRegistry::kMaxTags));
+    for (int i = 0; i < shard_count; ++i)
+    {
+        // Each context is only ever run by one thread.
+        io_contexts_.push_back(std::make_unique<asio::io_context>(1));
+    }
+
+    // Channels are bound in shard order, so each one's index in the port's SO_REUSEPORT group is
+    // its shard's (see UdpChannel.h).
+    std::vector<UdpChannel *> group;
+    for (int i = 0; i < shard_count; ++i)
+    {
+        udp_channels_.push_back(std::make_unique<UdpChannel>(*io_contexts_[i], port, i));
+        group.push_back(udp_channels_.back().get());
+    }
+    for (auto &channel : udp_channels_)
+    {
+        channel->set_group(group);
+    }
+
+    lobby_ = std::make_unique<LobbyDirectory>(*io_contexts_[0], shard_count);
+    // Sized apart from the shard count: with one shard per core, rooms still get every core.
+    room_pool_ = std::make_unique<WorkStealingPool>(room_threads != 0 ? room_threads : WorkStealingPool::default_thread_count());
+    for (int i = 0; i < shard_count; ++i)
+    {
+        shards_.push_back(std::make_unique<Server>(*io_contexts_[i], port, *udp_channels_[i], *lobby_, *room_pool_, i));
+    }
+    std::cout << "Server started on port " << port << " with " << shard_count << " shards" << std::endl;
+}
+
+void ShardedServer::set_send_budget(SendBudget budget)
+{
+    for (auto &shard : shards_)
+    {
+        shard->set_send_budget(budget);
+    }
+}
+
+void ShardedServer::set_position_precision(float precision)
+{
+    for (auto &shard : shards_)
+    {
+        shard->set_position_precision(precision);
+    }
+}
+
+void ShardedServer::run()
+{
+    for (auto &shard : shards_)
+    {
+        shard->start();
+    }
+    for (auto &channel : udp_channels_)
+    {
+        channel->start();
+    }
+
+    threads_.reserve(io_contexts_.size());
+    for (auto &io_context : io_contexts_)
+    {
+        threads_.emplace_back([&io_context]()
+                              { io_context->run(); });
+    }
+
+    for (auto &t : threads_)
+    {
+        if (t.joinable())
+        {
+            t.join();
+        }
+    }
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include "stdafx.h"
+#include "Server.h"
+#include "UdpChannel.h"
+#include "LobbyDirectory.h"
+
+// 코어마다 io_context 하나를 두는 서버
+// Runs one io_context per core, each driven by a single thread and holding one Server shard with
+// its own SO_REUSEPORT acceptor and UDP channel, sessions and rooms. Completions never contend on a
+// shared scheduler. Shards only talk to each other for lobby-level work: the room list and moving a
+// player to the shard that owns the room being joined.
+// Rooms of every shard run on one shared WorkStealingPool, so a busy shard's rooms can borrow the
+// cores of an idle one.
+class ShardedServer
+{
+public:
+    // `room_threads` workers run the rooms; 0 picks one per core.
+    ShardedServer(unsigned short port, int shard_count, std::size_t room_threads = 0);
+    void set_send_budget(SendBudget budget);
+    void set_position_precision(float precision);
+    void run();
+
+private:
+    std::vector<std::unique_ptr<asio::io_context>> io_contexts_;
+    std::vector<std::unique_ptr<UdpChannel>> udp_channels_; // one per shard
+    std::unique_ptr<LobbyDirectory> lobby_;
+    std::unique_ptr<WorkStealingPool> room_pool_; // outlives the shards and their rooms
+    std::vector<std::unique_ptr<Server>> shards_;
+    std::vector<std::thread> threads_;
+};
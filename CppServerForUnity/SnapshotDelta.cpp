@@ -0,0 +1,105 @@
+#include "SnapshotDelta.h"
+#include "SchemaCodec.h"
+
+namespace
+{
+    const QuantizedPlayerState *find_player(const SnapshotFrame &frame, EntityId player_id)
+    {
+        for (const auto &player : frame.players)
+        {
+            if (player.player_id == player_id)
+            {
+                return &player;
+            }
+        }
+        return nullptr;
+    }
+
+    std::uint8_t changed_fields(const QuantizedPlayerState &player, const QuantizedPlayerState *before)
+    {
+        if (!before)
+        {
+            return kSnapshotAllFields;
+        }
+        std::uint8_t mask = 0;
+        if (player.position.x != before->position.x) mask |= kSnapshotPositionX;
+        if (player.position.y != before->position.y) mask |= kSnapshotPositionY;
+        if (player.position.z != before->position.z) mask |= kSnapshotPositionZ;
+        if (player.animation.forward != before->animation.forward) mask |= kSnapshotForward;
+        if (player.animation.strafe != before->animation.strafe) mask |= kSnapshotStrafe;
+        return mask;
+    }
+}
+
+SnapshotFrame &SnapshotHistory::push(std::uint32_t tick)
+{
+    SnapshotFrame &frame = frames_[tick % kCapacity];
+    frame.tick = tick;
+    frame.players.clear();
+    return frame;
+}
+
+const SnapshotFrame *SnapshotHistory::find(std::uint32_t tick) const
+{
+    const SnapshotFrame &frame = frames_[tick % kCapacity];
+    return tick != 0 && frame.tick == tick ? &frame : nullptr;
+}
+
+void append_snapshot_delta(std::string &out, const PositionQuantizer &quantizer, const SnapshotFrame &current, const SnapshotFrame *baseline)
+{
+    schema_detail::BinaryWriter writer(out);
+    writer.varint(current.tick);
+    writer.varint(baseline ? baseline->tick : 0);
+    if (!baseline)
+    {
+        append_binary(out, quantizer.origin);
+        writer.f32(quantizer.precision);
+    }
+
+    auto mask_of = [&](const QuantizedPlayerState &player)
+    {
+        return changed_fields(player, baseline ? find_player(*baseline, player.player_id) : nullptr);
+    };
+
+    // The entry count precedes the entries, so the masks are worked out twice.
+    std::size_t changed = 0;
+    for (const auto &player : current.players)
+    {
+        changed += mask_of(player) != 0;
+    }
+    writer.varint(changed);
+    for (const auto &player : current.players)
+    {
+        const std::uint8_t mask = mask_of(player);
+        if (mask == 0)
+        {
+            continue;
+        }
+        writer.varint(player.player_id.value);
+        writer.u8(mask);
+        if (mask & kSnapshotPositionX) writer.u16(player.position.x);
+        if (mask & kSnapshotPositionY) writer.u16(player.position.y);
+        if (mask & kSnapshotPositionZ) writer.u16(player.position.z);
+        if (mask & kSnapshotForward) writer.u8(player.animation.forward);
+        if (mask & kSnapshotStrafe) writer.u8(player.animation.strafe);
+    }
+
+    if (!baseline)
+    {
+        writer.varint(0);
+        return;
+    }
+    std::size_t removed = 0;
+    for (const auto &player : baseline->players)
+    {
+        removed += find_player(current, player.player_id) == nullptr;
+    }
+    writer.varint(removed);
+    for (const auto &player : baseline->players)
+    {
+        if (!find_player(current, player.player_id))
+        {
+            writer.varint(player.player_id.value);
+        }
+    }
+}
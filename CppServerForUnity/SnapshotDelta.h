@@ -0,0 +1,59 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "Schema.h"
+#include "SnapshotQuantization.h"
+
+// 스냅샷 델타 압축
+// game_state_update in Encoding::Schema. Each snapshot carries the room's tick number and is
+// encoded against a baseline: the newest snapshot the client confirmed with snapshot_ack, while
+// the room still remembers it. Without one (on join, before the first ack, or once the ack is
+// older than the history) the baseline is 0 and the snapshot is full. The client keeps the
+// snapshots it received by tick, applies a delta to its copy of the baseline, and acks the result.
+//
+// Layout, using the field encodings of Schema.h:
+//   u32 varint          tick
+//   u32 varint          baseline tick, 0 for a full snapshot
+//   PositionInfo, f32   quantizer origin and precision, full snapshots only; deltas reuse the baseline's
+//   varint count, then  one entry per player that changed since the baseline:
+//     varint              player_id
+//     u8                  mask of the fields that follow, in this order:
+//                           bit 0 u16 position.x, bit 1 u16 position.y, bit 2 u16 position.z,
+//                           bit 3 u8 animation.forward, bit 4 u8 animation.strafe
+//   varint count, then  player_id of every baseline player no longer in the room
+// A player missing from the baseline gets every field. Quantized values are as in
+// SnapshotQuantization.h.
+
+constexpr std::uint8_t kSnapshotPositionX = 1 << 0;
+constexpr std::uint8_t kSnapshotPositionY = 1 << 1;
+constexpr std::uint8_t kSnapshotPositionZ = 1 << 2;
+constexpr std::uint8_t kSnapshotForward = 1 << 3;
+constexpr std::uint8_t kSnapshotStrafe = 1 << 4;
+constexpr std::uint8_t kSnapshotAllFields = 0x1f;
+
+struct SnapshotFrame
+{
+    std::uint32_t tick = 0; // 0: empty
+    std::vector<QuantizedPlayerState> players;
+};
+
+// The room's most recent snapshots, indexed by tick. Slots are reused, keeping their capacity.
+class SnapshotHistory
+{
+public:
+    static constexpr std::size_t kCapacity = 32; // 1.6 s at 20 ticks per second
+
+    // The slot for `tick`, emptied.
+    SnapshotFrame &push(std::uint32_t tick);
+    // The snapshot for `tick`, or null if it was never taken or has been overwritten.
+    const SnapshotFrame *find(std::uint32_t tick) const;
+
+private:
+    std::array<SnapshotFrame, kCapacity> frames_;
+};
+
+// Appends `current` encoded against `baseline` (null for a full snapshot).
+void append_snapshot_delta(std::string &out, const PositionQuantizer &quantizer, const SnapshotFrame &current, const SnapshotFrame *baseline);
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include "Schema.h"
+
+// 스냅샷 양자화
+// Fixed-point forms of the values in a game_state_update sent in Encoding::Schema
+// (see SnapshotDelta.h). Clients invert them with the dequantize_* helpers, which
+// NetworkModels.cs mirrors:
+//   position = origin + q * precision   per axis; q is a u16, origin and precision come with the snapshot
+//   blend    = (q - 128) / 127          q is a u8; 128 is exactly 0, 1 and 255 exactly -1 and 1
+// Positions outside the room bounds are clamped to them and blend values to [-1, 1]. A NaN
+// position encodes as the origin, a NaN blend value as 0.
+
+constexpr float kDefaultPositionPrecision = 0.02f; // world units per step
+
+// The volume a room's players can be encoded in.
+struct RoomBounds
+{
+    PositionInfo min{-512, -64, -512};
+    PositionInfo max{512, 64, 512};
+};
+
+struct PositionQuantizer
+{
+    PositionInfo origin;
+    float precision = 1.0f; // world units per step
+
+    std::uint16_t quantize(float value, float axis_origin) const
+    {
+        const float steps = std::round((value - axis_origin) / precision);
+        return std::isnan(steps) ? 0 : static_cast<std::uint16_t>(std::clamp(steps, 0.0f, 65535.0f));
+    }
+
+    QuantizedPosition quantize(const PositionInfo &position) const
+    {
+        return {quantize(position.x, origin.x), quantize(position.y, origin.y), quantize(position.z, origin.z)};
+    }
+};
+
+// `precision` is coarsened if needed so that the widest axis of `bounds` fits in 16 bits.
+inline PositionQuantizer make_position_quantizer(const RoomBounds &bounds, float precision)
+{
+    const float extent = std::max({bounds.max.x - bounds.min.x, bounds.max.y - bounds.min.y, bounds.max.z - bounds.min.z});
+    return {bounds.min, std::max(precision, extent / 65535.0f)};
+}
+
+inline float dequantize_position(std::uint16_t q, float axis_origin, float precision)
+{
+    return axis_origin + static_cast<float>(q) * precision;
+}
+
+inline std::uint8_t quantize_blend(float value)
+{
+    if (std::isnan(value))
+    {
+        return 128;
+    }
+    const float steps = std::round(std::clamp(value, -1.0f, 1.0f) * 127.0f);
+    return static_cast<std::uint8_t>(static_cast<int>(steps) + 128);
+}
+
+inline float dequantize_blend(std::uint8_t q)
+{
+    return static_cast<float>(static_cast<int>(q) - 128) / 127.0f;
+}
+
+inline QuantizedAnimation quantize(const AnimationInfo &animation)
+{
+    return {quantize_blend(animation.forward), quantize_blend(animation.strafe)};
+}
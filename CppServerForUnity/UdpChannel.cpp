@@ -0,0 +1,360 @@
+#include "UdpChannel.h"
+#include "Server.h"
+#include "Session.h"
+#ifdef SO_ATTACH_REUSEPORT_CBPF
+#include <linux/filter.h>
+#endif
+
+namespace
+{
+    // 64 bits from the operating system's CSPRNG (std::random_device reads getrandom(2) or
+    // /dev/urandom on Linux and BCryptGenRandom on Windows).
+    std::uint64_t random_u64()
+    {
+        thread_local std::random_device entropy;
+        const std::uint64_t high = entropy();
+        const std::uint64_t low = entropy();
+        return high << 32 | low;
+    }
+
+    // Every shard's channel listens on the same port. Datagrams are steered by the first byte of
+    // their payload, the low byte of the token, which is the index of the shard that issued it and
+    // so of its socket in the port's group. Without steering the kernel spreads them by address,
+    // and handle_datagram() passes on whatever reached the wrong shard.
+    udp::socket make_reuse_port_socket(asio::io_context &io_context, unsigned short port)
+    {
+#ifdef SO_REUSEPORT
+        using reuse_port = asio::detail::socket_option::boolean<SOL_SOCKET, SO_REUSEPORT>;
+        udp::socket socket(io_context);
+        const udp::endpoint endpoint(udp::v4(), port);
+        socket.open(endpoint.protocol());
+        socket.set_option(udp::socket::reuse_address(true));
+        socket.set_option(reuse_port(true));
+        socket.bind(endpoint);
+#ifdef SO_ATTACH_REUSEPORT_CBPF
+        sock_filter steer[] = {
+            {BPF_LD | BPF_B | BPF_ABS, 0, 0, 0}, // A = token & 0xff
+            {BPF_RET | BPF_A, 0, 0, 0},          // an index past the group falls back to hashing
+        };
+        sock_fprog program{static_cast<unsigned short>(std::size(steer)), steer};
+        setsockopt(socket.native_handle(), SOL_SOCKET, SO_ATTACH_REUSEPORT_CBPF, &program, sizeof(program));
+#endif
+        return socket;
+#else
+        throw std::runtime_error("sharded mode requires SO_REUSEPORT");
+#endif
+    }
+}
+
+UdpChannel::UdpChannel(asio::io_context &io_context, unsigned short port)
+    : socket_(io_context, udp::endpoint(udp::v4(), port)),
+      strand_(io_context.get_executor()),
+      update_timer_(io_context)
+{
+    // Datagrams are fire-and-forget: a full send buffer drops the packet instead of blocking the strand.
+    socket_.non_blocking(true);
+}
+
+UdpChannel::UdpChannel(asio::io_context &io_context, unsigned short port, int shard_index)
+    : socket_(make_reuse_port_socket(io_context, port)),
+      strand_(io_context.get_executor()),
+      update_timer_(io_context),
+      shard_index_(static_cast<std::uint64_t>(shard_index))
+{
+    socket_.non_blocking(true);
+}
+
+void UdpChannel::start()
+{
+    asio::post(strand_, [this]()
+               {
+        do_receive();
+        start_update_timer(); });
+}
+
+// Tokens are independent random numbers, so one says nothing about another. With 56 random bits a
+// clash between live sessions is too unlikely to check for.
+std::uint64_t UdpChannel::register_session(std::shared_ptr<Session> session)
+{
+    std::uint64_t token = 0;
+    while (token == 0)
+    {
+        token = random_u64() << 8 | shard_index_; // 56 random bits, clear of the shard byte
+    }
+
+    asio::post(strand_, [this, token, session = std::move(session)]()
+               {
+        std::unique_lock lock(peers_mutex_);
+        peers_[token].session = session; });
+    return token;
+}
+
+void UdpChannel::unregister_session(std::uint64_t token)
+{
+    UdpChannel &owner = owner_of(token);
+    if (&owner != this)
+    {
+        owner.unregister_session(token);
+        return;
+    }
+    asio::post(strand_, [this, token]()
+               {
+        std::unique_lock lock(peers_mutex_);
+        peers_.erase(token); });
+}
+
+void UdpChannel::confirm(std::uint64_t token, const std::shared_ptr<Session> &session, std::uint64_t challenge)
+{
+    UdpChannel &owner = owner_of(token);
+    if (&owner != this)
+    {
+        owner.confirm(token, session, challenge);
+        return;
+    }
+    asio::post(strand_, [this, token, session, challenge]()
+               {
+        auto it = peers_.find(token);
+        if (it == peers_.end())
+        {
+            return;
+        }
+        Peer &peer = it->second;
+        const bool match = peer.challenge != 0 && peer.challenge == challenge && peer.session.lock() == session;
+        peer.challenge = 0;
+        if (!match)
+        {
+            return;
+        }
+
+        std::lock_guard lock(peer.mutex);
+        if (!peer.bound)
+        {
+            // The last message over TCP before the switch; see UdpChannel.h.
+            static const OutboundMessage switch_marker = make_outbound_message(
+                MessageType::UdpHello, make_message("{\"type\":\"udp_hello\"}"), make_message(std::string()));
+            session->write(switch_marker);
+        }
+        peer.endpoint = peer.candidate;
+        peer.bound = true;
+        // Tells the client the endpoint is bound.
+        static const auto bound_ack = make_message(std::string());
+        send_datagram(peer.endpoint, peer.link.prepare(Channel::Unreliable, MessageType::UdpHello, bound_ack, ReliableEndpoint::Clock::now()), *bound_ack); });
+}
+
+// Runs on the caller's thread. The transport is picked and the message handed to it under the
+// peer's mutex, which a switch between UDP and TCP also holds, so a peer's messages go out in the
+// order they were sent whichever transport each one takes. Senders to different peers never meet.
+void UdpChannel::send(std::uint64_t token, const std::shared_ptr<Session> &session, Channel channel, OutboundMessage msg)
+{
+    UdpChannel &owner = owner_of(token);
+    if (&owner != this)
+    {
+        owner.send(token, session, channel, std::move(msg));
+        return;
+    }
+
+    std::shared_lock table(peers_mutex_);
+    auto it = peers_.find(token);
+    if (it == peers_.end())
+    {
+        // Not registered yet, or already gone: TCP is the only way to it.
+        table.unlock();
+        session->write(std::move(msg));
+        return;
+    }
+    Peer &peer = it->second;
+    std::lock_guard lock(peer.mutex);
+    if (!peer.bound)
+    {
+        session->write(std::move(msg));
+        return;
+    }
+    const SharedMessage &payload = msg.payload(session->encoding());
+    const PacketHeader header = peer.link.prepare(channel, msg.type, payload, ReliableEndpoint::Clock::now());
+    if (peer.link.failed())
+    {
+        fall_back_to_tcp(peer); // this message included
+        return;
+    }
+    send_datagram(peer.endpoint, header, *payload);
+}
+
+// The channel that issued `token`, which holds its peer.
+UdpChannel &UdpChannel::owner_of(std::uint64_t token)
+{
+    const std::uint64_t shard = token & kShardMask;
+    return shard < group_.size() ? *group_[shard] : *this;
+}
+
+void UdpChannel::do_receive()
+{
+    socket_.async_receive_from(asio::buffer(recv_buffer_), recv_endpoint_, asio::bind_executor(strand_, [this](const asio::error_code &ec, std::size_t length)
+                                                                                                  {
+        if (!ec)
+        {
+            handle_datagram(std::string_view(recv_buffer_.data(), length), recv_endpoint_);
+        }
+        else if (ec == asio::error::operation_aborted)
+        {
+            return;
+        }
+        // ICMP errors from earlier sends (connection_refused etc.) must not stop the receive loop.
+        do_receive(); }));
+}
+
+void UdpChannel::handle_datagram(std::string_view datagram, const udp::endpoint &from)
+{
+    if (datagram.size() < kUdpTokenSize + kPacketHeaderSize)
+    {
+        return;
+    }
+
+    const auto *data = reinterpret_cast<const std::uint8_t *>(datagram.data());
+    std::uint64_t token = 0;
+    for (std::size_t i = kUdpTokenSize; i-- > 0;)
+    {
+        token = token << 8 | data[i];
+    }
+    UdpChannel &owner = owner_of(token);
+    if (&owner != this)
+    {
+        // Reached the wrong shard's socket: the peer lives on the shard that issued the token.
+        asio::post(owner.strand_, [&owner, copy = std::string(datagram), from]()
+                   { owner.handle_datagram(copy, from); });
+        return;
+    }
+
+    PacketHeader header;
+    if (!decode_packet_header(data + kUdpTokenSize, header))
+    {
+        return;
+    }
+
+    auto it = peers_.find(token);
+    if (it == peers_.end())
+    {
+        return;
+    }
+    auto session = it->second.session.lock();
+    if (!session)
+    {
+        std::unique_lock lock(peers_mutex_);
+        peers_.erase(it);
+        return;
+    }
+
+    Peer &peer = it->second;
+    if (header.type == MessageType::UdpHello)
+    {
+        send_challenge(peer, from);
+        return;
+    }
+    // The token alone proves nothing (it is in every datagram); only the bound endpoint is heard.
+    // Delivering under the peer's mutex is safe: handle_request() only ever posts.
+    std::lock_guard lock(peer.mutex);
+    if (!peer.bound || peer.endpoint != from)
+    {
+        return;
+    }
+
+    const auto now = ReliableEndpoint::Clock::now();
+    const std::string_view payload = datagram.substr(kUdpTokenSize + kPacketHeaderSize);
+    peer.link.receive(header, payload, now, [this, &session, channel = header.channel](MessageType type, std::string_view message)
+                      { deliver(session, channel, type, message); });
+}
+
+// Answers a udp_hello from `from` with a fresh challenge, replacing any earlier one. The peer's
+// binding does not change until the challenge comes back over TCP (see confirm()).
+void UdpChannel::send_challenge(Peer &peer, const udp::endpoint &from)
+{
+    peer.candidate = from;
+    peer.challenge = 0;
+    while (peer.challenge == 0)
+    {
+        peer.challenge = random_u64();
+    }
+
+    std::string payload(sizeof(peer.challenge), '\0');
+    for (std::size_t i = 0; i < payload.size(); ++i)
+    {
+        payload[i] = static_cast<char>(peer.challenge >> (8 * i)); // little-endian
+    }
+    PacketHeader header;
+    header.type = MessageType::UdpHello;
+    send_datagram(from, header, payload);
+}
+
+// Real-time input and snapshot acks are accepted on any channel. Other requests must come on a reliable channel,
+// where they keep the same guarantees they had over TCP; udp_confirm is only taken from TCP.
+// Requests go to whichever shard currently owns the session.
+void UdpChannel::deliver(const std::shared_ptr<Session> &session, Channel channel, MessageType type, std::string_view payload)
+{
+    if (type == MessageType::UdpConfirm)
+    {
+        return;
+    }
+    if (type == MessageType::PlayerInput || type == MessageType::SnapshotAck || is_reliable(channel))
+    {
+        session->server().handle_request(session, type, payload);
+    }
+}
+
+void UdpChannel::start_update_timer()
+{
+    update_timer_.expires_after(kUpdateInterval);
+    update_timer_.async_wait(asio::bind_executor(strand_, [this](const asio::error_code &ec)
+                                                 {
+        if (ec)
+        {
+            return;
+        }
+
+        const auto now = ReliableEndpoint::Clock::now();
+        for (auto &[token, peer] : peers_)
+        {
+            std::lock_guard lock(peer.mutex);
+            if (!peer.bound)
+            {
+                continue;
+            }
+            peer.link.update(now, [this, &peer](const PacketHeader &header, const std::string &payload)
+                             { send_datagram(peer.endpoint, header, payload); });
+            if (peer.link.failed())
+            {
+                fall_back_to_tcp(peer);
+            }
+        }
+        start_update_timer(); }));
+}
+
+// Called with the peer's mutex held. The unacked messages are written to the session before the
+// peer shows as unbound to senders, so anything sent after them over TCP arrives after them too.
+void UdpChannel::fall_back_to_tcp(Peer &peer)
+{
+    std::cerr << "UDP peer stopped acking, falling back to TCP" << std::endl;
+    if (auto session = peer.session.lock())
+    {
+        for (auto &[type, payload] : peer.link.take_pending())
+        {
+            // Already encoded for this session, so either encoding slot will do.
+            session->write(make_outbound_message(type, payload, payload));
+        }
+    }
+    peer.bound = false;
+    peer.link = ReliableEndpoint();
+}
+
+// Called from any sender's thread. A synchronous send on the non-blocking socket is a single
+// sendto(2), which leaves asio's reactor state alone and which the kernel serializes.
+void UdpChannel::send_datagram(const udp::endpoint &endpoint, const PacketHeader &header, const std::string &payload)
+{
+    const PacketHeaderBytes header_bytes = encode_packet_header(header);
+    const std::array<asio::const_buffer, 2> buffers = {asio::buffer(header_bytes), asio::buffer(payload)};
+
+    asio::error_code ec;
+    socket_.send_to(buffers, endpoint, 0, ec);
+    if (ec && ec != asio::error::would_block)
+    {
+        std::cerr << "UDP send error: " << ec.message() << std::endl;
+    }
+}
@@ -0,0 +1,100 @@
+#pragma once
+
+#include "stdafx.h"
+#include "Message.h"
+#include "Protocol.h"
+#include "ReliableEndpoint.h"
+#include <asio/steady_timer.hpp>
+#include <shared_mutex>
+
+class Session;
+
+// 실시간 데이터와 방 이벤트를 위한 UDP 채널
+// Datagram channel bound next to the TCP acceptor. A session gets a random token in its assign_id
+// message. To bind a UDP endpoint the client sends a udp_hello datagram carrying the token; the
+// server answers that endpoint with a udp_hello holding a random u64 challenge, and the endpoint is
+// bound once the client echoes the challenge in a udp_confirm over its TCP session. Datagrams from
+// any other endpoint are dropped, token or not, so a client whose address changes (NAT rebinding)
+// binds again the same way. Each bound peer has a ReliableEndpoint, so messages can be sent on any
+// Channel.
+//
+// In sharded mode every shard has its own channel on its own SO_REUSEPORT socket. A token's low
+// byte names the shard that issued it, and that shard's channel keeps the peer for good, even after
+// the player moves to another shard. The kernel is asked to deliver each datagram to the socket of
+// its token's shard; one that lands on another shard's socket anyway is handed over.
+//
+// A peer whose ReliableEndpoint gives up (it stopped acking) is unbound: what it had not acked is
+// sent again over TCP, and so is everything after, until the client binds again.
+//
+// Ordering across a switch: every message to a peer takes its transport under the peer's mutex,
+// in send order. Going back to TCP, the unacked messages are rewritten before anything newer.
+// Going to UDP, the server writes a udp_hello over TCP as the last TCP message, and the client
+// must read up to it before it delivers anything that came over UDP.
+//
+// Receiving, the handshake and the update timer run on strand_, which alone changes the peer
+// table; senders look peers up from their own threads under a shared lock.
+class UdpChannel
+{
+public:
+    UdpChannel(asio::io_context &io_context, unsigned short port);
+    // Shard `shard_index` of a channel group sharing `port`; see set_group().
+    UdpChannel(asio::io_context &io_context, unsigned short port, int shard_index);
+    void start();
+
+    // Every channel of the group, indexed by shard. Set before any channel starts.
+    void set_group(std::vector<UdpChannel *> group) { group_ = std::move(group); }
+
+    // Issues a token for the session. Safe to call from any thread.
+    std::uint64_t register_session(std::shared_ptr<Session> session);
+    void unregister_session(std::uint64_t token);
+    // Binds the endpoint the token's last challenge went to, if `challenge` is that challenge.
+    // `session` must be the one the challenge was echoed on; call only for udp_confirm read from
+    // TCP. A confirm with the wrong challenge uses it up.
+    void confirm(std::uint64_t token, const std::shared_ptr<Session> &session, std::uint64_t challenge);
+
+    // Sends over UDP on `channel` if the token's peer has bound an endpoint, otherwise over the
+    // session's TCP stream, which already satisfies every channel's guarantees. Like
+    // unregister_session(), it may be called on any channel of the group.
+    void send(std::uint64_t token, const std::shared_ptr<Session> &session, Channel channel, OutboundMessage msg);
+
+private:
+    struct Peer
+    {
+        std::weak_ptr<Session> session;
+        udp::endpoint candidate; // sent the last udp_hello; bound once `challenge` comes back over TCP
+        std::uint64_t challenge = 0; // 0: none outstanding
+
+        std::mutex mutex; // guards the binding and the link, which senders use from their threads
+        udp::endpoint endpoint;
+        bool bound = false;
+        ReliableEndpoint link;
+    };
+
+    static constexpr std::uint64_t kShardMask = 0xff; // token bits naming the issuing shard
+
+    UdpChannel &owner_of(std::uint64_t token);
+    void do_receive();
+    void handle_datagram(std::string_view datagram, const udp::endpoint &from);
+    void send_challenge(Peer &peer, const udp::endpoint &from);
+    void deliver(const std::shared_ptr<Session> &session, Channel channel, MessageType type, std::string_view payload);
+    void fall_back_to_tcp(Peer &peer);
+    void start_update_timer();
+    void send_datagram(const udp::endpoint &endpoint, const PacketHeader &header, const std::string &payload);
+
+    static constexpr std::chrono::milliseconds kUpdateInterval{10}; // resend / ack flush 주기
+
+    udp::socket socket_;
+    asio::strand<asio::io_context::executor_type> strand_;
+    asio::steady_timer update_timer_;
+
+    // token -> peer. Only strand_ changes the table, under a unique lock; send() looks peers up
+    // under a shared one.
+    std::unordered_map<std::uint64_t, Peer> peers_;
+    std::shared_mutex peers_mutex_;
+
+    const std::uint64_t shard_index_ = 0;
+    std::vector<UdpChannel *> group_; // empty for a standalone channel
+
+    std::array<char, kMaxDatagramSize> recv_buffer_;
+    udp::endpoint recv_endpoint_;
+};
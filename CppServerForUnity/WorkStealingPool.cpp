@@ -0,0 +1,131 @@
+#include "WorkStealingPool.h"
+
+namespace
+{
+    // The pool and worker the calling thread belongs to, if it is a worker.
+    thread_local const void *current_pool = nullptr;
+    thread_local std::size_t current_worker = 0;
+}
+
+WorkStealingPool::WorkStealingPool(std::size_t thread_count)
+{
+    thread_count = std::max<std::size_t>(1, thread_count);
+    for (std::size_t i = 0; i < thread_count; ++i)
+    {
+        workers_.push_back(std::make_unique<Worker>());
+    }
+    threads_.reserve(thread_count);
+    for (std::size_t i = 0; i < thread_count; ++i)
+    {
+        threads_.emplace_back([this, i]()
+                              { work(i); });
+    }
+}
+
+std::size_t WorkStealingPool::default_thread_count()
+{
+    return std::max(1u, std::thread::hardware_concurrency());
+}
+
+// Tasks still queued are dropped, before the services they may refer to (strands) go away.
+WorkStealingPool::~WorkStealingPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(sleep_mutex_);
+        stopping_ = true;
+    }
+    wake_.notify_all();
+    for (auto &thread : threads_)
+    {
+        thread.join();
+    }
+    for (auto &worker : workers_)
+    {
+        worker->tasks.clear();
+    }
+    shutdown();
+    destroy();
+}
+
+// A worker queues onto its own deque, where it will find the task first; other threads spread
+// their tasks over the workers in turn.
+void WorkStealingPool::submit(std::unique_ptr<Task> task)
+{
+    const std::size_t index = current_pool == this
+                                  ? current_worker
+                                  : next_worker_.fetch_add(1, std::memory_order_relaxed) % workers_.size();
+    queued_.fetch_add(1);
+    {
+        Worker &worker = *workers_[index];
+        std::lock_guard<std::mutex> lock(worker.mutex);
+        worker.tasks.push_back(std::move(task));
+    }
+    // A worker counts itself in sleepers_ before it checks queued_, and the count above comes
+    // before this check, so either it sees the task or this sees it. Taking the lock then makes
+    // sure it is already waiting, or has not checked yet, when it is notified.
+    if (sleepers_.load() > 0)
+    {
+        {
+            std::lock_guard<std::mutex> lock(sleep_mutex_);
+        }
+        wake_.notify_one();
+    }
+}
+
+// The newest task of worker `index`, or else the oldest task of the first other worker that has one.
+std::unique_ptr<WorkStealingPool::Task> WorkStealingPool::take(std::size_t index)
+{
+    for (std::size_t i = 0; i < workers_.size(); ++i)
+    {
+        Worker &worker = *workers_[(index + i) % workers_.size()];
+        std::lock_guard<std::mutex> lock(worker.mutex);
+        if (!worker.tasks.empty())
+        {
+            std::unique_ptr<Task> task;
+            if (i == 0)
+            {
+                task = std::move(worker.tasks.back());
+                worker.tasks.pop_back();
+            }
+            else
+            {
+                task = std::move(worker.tasks.front());
+                worker.tasks.pop_front();
+            }
+            queued_.fetch_sub(1);
+            return task;
+        }
+    }
+    return nullptr;
+}
+
+void WorkStealingPool::work(std::size_t index)
+{
+    current_pool = this;
+    current_worker = index;
+    while (true)
+    {
+        if (auto task = take(index))
+        {
+            try
+            {
+                task->run();
+            }
+            catch (std::exception &e)
+            {
+                std::cerr << "Room task failed: " << e.what() << std::endl;
+            }
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(sleep_mutex_);
+        sleepers_.fetch_add(1);
+        wake_.wait(lock, [this]()
+                   { return stopping_ || queued_.load() > 0; });
+        sleepers_.fetch_sub(1);
+        if (stopping_)
+        {
+            return;
+        }
+    }
+}
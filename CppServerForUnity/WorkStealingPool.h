@@ -0,0 +1,94 @@
+#pragma once
+
+#include "stdafx.h"
+#include <condition_variable>
+
+// 작업 훔치기 스레드 풀
+// Where rooms run: every Room's strand sits on this pool instead of an io_context, so room
+// requests and ticks are spread over one thread per core while network completions stay on the
+// io threads. Each worker has its own deque. It runs the newest task it queued itself first, and
+// when it runs dry it steals the oldest task of another worker, so a tick's big and small rooms
+// even out across cores without anyone assigning them. A room's strand still runs its handlers
+// one at a time, on whichever worker picks them up.
+//
+// The pool is an asio execution context; get_executor() can back an asio::strand or be passed
+// to asio::post like any other executor.
+class WorkStealingPool : public asio::execution_context
+{
+public:
+    class executor_type;
+
+    explicit WorkStealingPool(std::size_t thread_count);
+    ~WorkStealingPool();
+
+    // One worker per core. Room ticks are the CPU-bound work; io threads spend most of their time
+    // waiting on sockets, so the pool is not shrunk to make room for them.
+    static std::size_t default_thread_count();
+
+    executor_type get_executor() noexcept;
+    std::size_t thread_count() const { return workers_.size(); }
+
+private:
+    struct Task
+    {
+        virtual ~Task() = default;
+        virtual void run() = 0;
+    };
+
+    template <class F>
+    struct FunctionTask : Task
+    {
+        explicit FunctionTask(F f) : f(std::move(f)) {}
+        void run() override { f(); }
+        F f;
+    };
+
+    struct Worker
+    {
+        std::mutex mutex;
+        std::deque<std::unique_ptr<Task>> tasks; // owner pops the back, thieves take the front
+    };
+
+    void submit(std::unique_ptr<Task> task);
+    std::unique_ptr<Task> take(std::size_t index);
+    void work(std::size_t index);
+
+    std::vector<std::unique_ptr<Worker>> workers_;
+    std::vector<std::thread> threads_;
+    std::atomic<std::size_t> next_worker_{0}; // round-robin target for tasks from other threads
+    std::atomic<std::size_t> queued_{0};      // tasks in all deques, counted before they are pushed
+
+    // Idle workers sleep here until something is queued. submit() only takes the mutex when
+    // sleepers_ says someone may be waiting.
+    std::atomic<std::size_t> sleepers_{0};
+    std::mutex sleep_mutex_;
+    std::condition_variable wake_;
+    bool stopping_ = false;
+};
+
+class WorkStealingPool::executor_type
+{
+public:
+    WorkStealingPool &query(asio::execution::context_t) const noexcept { return *pool_; }
+    static constexpr asio::execution::blocking_t query(asio::execution::blocking_t) noexcept { return asio::execution::blocking.never; }
+
+    template <class F>
+    void execute(F &&f) const
+    {
+        pool_->submit(std::make_unique<FunctionTask<std::decay_t<F>>>(std::forward<F>(f)));
+    }
+
+    friend bool operator==(const executor_type &a, const executor_type &b) noexcept { return a.pool_ == b.pool_; }
+    friend bool operator!=(const executor_type &a, const executor_type &b) noexcept { return a.pool_ != b.pool_; }
+
+private:
+    friend class WorkStealingPool;
+    explicit executor_type(WorkStealingPool &pool) noexcept : pool_(&pool) {}
+
+    WorkStealingPool *pool_;
+};
+
+inline WorkStealingPool::executor_type WorkStealingPool::get_executor() noexcept
+{
+    return executor_type(*this);
+}
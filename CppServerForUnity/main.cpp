@@ -1,13 +1,112 @@
 #include "stdafx.h"
 #include "Server.h"
+#include "ShardedServer.h"
+#include "SnapshotQuantization.h"
+#include "MovementKernel.h"
+#include <cerrno>
+#include <charconv>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
 
-int main() {
+// Usage: lobby_server [--port PORT] [--shards N] [--room-threads N] [--send-budget BYTES]
+//                     [--slow-consumer drop|degrade|disconnect] [--position-precision UNITS]
+// --port is the TCP and UDP port (8080 by default).
+// --shards runs one io_context per shard (N = 0 picks one per core) instead of a shared one.
+// --room-threads sizes the pool the rooms run on (N = 0, the default, picks one per core).
+// --send-budget and --slow-consumer set how much unsent data a client may build up and what
+// happens when it exceeds that (see SendBudget.h). --position-precision is the step size of
+// positions in binary snapshots (see SnapshotQuantization.h).
+static const char* const kUsage =
+    "Usage: lobby_server [--port PORT] [--shards N] [--room-threads N] [--send-budget BYTES]\n"
+    "                    [--slow-consumer drop|degrade|disconnect] [--position-precision UNITS]";
+
+// Whole-string integer in [min, max].
+template <class Integer>
+static bool parse_integer(const char* text, Integer min, Integer max, Integer& out) {
+    const char* end = text + std::strlen(text);
+    Integer value{};
+    const auto result = std::from_chars(text, end, value);
+    if (result.ec != std::errc() || result.ptr != end || value < min || value > max) {
+        return false;
+    }
+    out = value;
+    return true;
+}
+
+// Whole-string finite number greater than zero.
+static bool parse_positive_float(const char* text, float& out) {
+    char* end = nullptr;
+    errno = 0;
+    const float value = std::strtof(text, &end);
+    if (end == text || *end != '\0' || errno != 0 || !std::isfinite(value) || value <= 0.0f) {
+        return false;
+    }
+    out = value;
+    return true;
+}
+
+int main(int argc, char* argv[]) {
     try {
-        asio::io_context io_context;
-        Server server(io_context, 8080);
-        server.run();
+        unsigned short port = 8080;
+        int shard_count = -1;
+        std::size_t room_threads = 0;
+        SendBudget send_budget;
+        float position_precision = kDefaultPositionPrecision;
+        // Every option takes a value.
+        for (int i = 1; i < argc; ++i) {
+            const std::string arg = argv[i];
+            if (arg != "--port" && arg != "--shards" && arg != "--room-threads" && arg != "--send-budget" &&
+                arg != "--position-precision" && arg != "--slow-consumer") {
+                std::cerr << "Unknown option: " << arg << "\n" << kUsage << std::endl;
+                return 1;
+            }
+            if (i + 1 >= argc) {
+                std::cerr << "Missing value for " << arg << "\n" << kUsage << std::endl;
+                return 1;
+            }
+            const char* value = argv[++i];
+            bool valid = true;
+            if (arg == "--port") {
+                int number = 0;
+                valid = parse_integer(value, 1, 65535, number);
+                port = static_cast<unsigned short>(number);
+            } else if (arg == "--shards") {
+                valid = parse_integer(value, 0, static_cast<int>(PlayerRegistry::kMaxTags), shard_count);
+            } else if (arg == "--room-threads") {
+                valid = parse_integer<std::size_t>(value, 0, 1024, room_threads);
+            } else if (arg == "--send-budget") {
+                valid = parse_integer<std::size_t>(value, 1, SIZE_MAX, send_budget.max_pending_bytes);
+            } else if (arg == "--position-precision") {
+                valid = parse_positive_float(value, position_precision);
+            } else {
+                valid = parse_slow_consumer_policy(value, send_budget.policy);
+            }
+            if (!valid) {
+                std::cerr << "Bad value for " << arg << ": " << value << "\n" << kUsage << std::endl;
+                return 1;
+            }
+        }
+
+        std::cout << "Movement kernel: " << movement_kernel_name() << std::endl;
+        if (shard_count >= 0) {
+            if (shard_count == 0) {
+                shard_count = std::max(1, (int)std::thread::hardware_concurrency());
+            }
+            ShardedServer server(port, shard_count, room_threads);
+            server.set_send_budget(send_budget);
+            server.set_position_precision(position_precision);
+            server.run();
+        } else {
+            asio::io_context io_context;
+            Server server(io_context, port, room_threads);
+            server.set_send_budget(send_budget);
+            server.set_position_precision(position_precision);
+            server.run();
+        }
     } catch (std::exception& e) {
         std::cerr << "Exception: " << e.what() << std::endl;
+        return 1;
     }
 
     return 0;
@@ -5,19 +5,25 @@
 #include <string>
 #include <vector>
 #include <map>
+#include <unordered_map>
+#include <deque>
 #include <mutex>
 #include <thread>
 #include <functional>
 #include <memory>
 #include <atomic>
 #include <algorithm>
+#include <array>
+#include <random>
 
 // Third-party Libraries
 #include <asio/strand.hpp>
 #include <asio/ip/tcp.hpp> // Add this for tcp::socket, tcp::acceptor
+#include <asio/ip/udp.hpp>
 #include <asio/ts/buffer.hpp>
 #include "nlohmann/json.hpp"
 
 // Common using declarations
 using asio::ip::tcp;
+using asio::ip::udp;
 using json = nlohmann::json;
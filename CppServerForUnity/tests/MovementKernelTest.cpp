@@ -0,0 +1,115 @@
+#include "MovementKernel.h"
+#include "TestCheck.h"
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <random>
+
+// Every SIMD movement kernel must match the scalar reference bit for bit, or rooms would drift
+// apart between machines. Lengths cover the vector loops and their scalar tails.
+
+namespace
+{
+    struct Input
+    {
+        std::vector<float> x, z, input_h, input_v;
+    };
+
+    // Mostly ordinary joystick values, with dead-zone, huge, tiny and non-finite ones mixed in.
+    float random_value(std::mt19937 &rng)
+    {
+        constexpr float inf = std::numeric_limits<float>::infinity();
+        constexpr float nan = std::numeric_limits<float>::quiet_NaN();
+        static const float special[] = {0.0f, -0.0f, 0.005f, -0.007f, 0.01f, 1e-30f, -1e-40f,
+                                        1e30f, -3e38f, inf, -inf, nan, -nan};
+        std::uniform_int_distribution<int> pick(0, 9);
+        if (pick(rng) == 0)
+        {
+            std::uniform_int_distribution<std::size_t> which(0, std::size(special) - 1);
+            return special[which(rng)];
+        }
+        return std::uniform_real_distribution<float>(-1.5f, 1.5f)(rng);
+    }
+
+    Input make_input(std::size_t count, std::mt19937 &rng)
+    {
+        Input input;
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            input.x.push_back(std::uniform_real_distribution<float>(-50.0f, 50.0f)(rng));
+            input.z.push_back(std::uniform_real_distribution<float>(-50.0f, 50.0f)(rng));
+            input.input_h.push_back(random_value(rng));
+            input.input_v.push_back(random_value(rng));
+        }
+        return input;
+    }
+
+    // Positions after one step of `kernel`.
+    Input run(const MovementKernel &kernel, Input input, float distance)
+    {
+        kernel.integrate({input.x.data(), input.z.data(), input.input_h.data(), input.input_v.data(), input.x.size()}, distance);
+        return input;
+    }
+
+    bool same_bits(const std::vector<float> &a, const std::vector<float> &b)
+    {
+        return a.size() == b.size() && std::memcmp(a.data(), b.data(), a.size() * sizeof(float)) == 0;
+    }
+
+    void test_kernels_match_scalar()
+    {
+        const std::vector<MovementKernel> kernels = available_movement_kernels();
+        CHECK(!kernels.empty() && std::strcmp(kernels.front().name, "scalar") == 0);
+        std::cout << "kernels:";
+        for (const auto &kernel : kernels)
+        {
+            std::cout << " " << kernel.name;
+        }
+        std::cout << std::endl;
+
+        std::mt19937 rng(20261016);
+        std::vector<std::size_t> counts;
+        for (std::size_t count = 0; count <= 33; ++count)
+        {
+            counts.push_back(count);
+        }
+        counts.push_back(1000);
+        counts.push_back(4099);
+
+        for (const std::size_t count : counts)
+        {
+            for (const float distance : {0.25f, 0.0f, -1.0f, 1e-7f})
+            {
+                const Input input = make_input(count, rng);
+                const Input expected = run(kernels.front(), input, distance);
+                for (std::size_t k = 1; k < kernels.size(); ++k)
+                {
+                    const Input actual = run(kernels[k], input, distance);
+                    const bool match = same_bits(actual.x, expected.x) && same_bits(actual.z, expected.z);
+                    if (!match)
+                    {
+                        std::cerr << kernels[k].name << " differs from scalar, count " << count << ", distance " << distance << std::endl;
+                    }
+                    CHECK(match);
+                }
+            }
+        }
+    }
+
+    void test_selected_kernel_is_available()
+    {
+        bool found = false;
+        for (const auto &kernel : available_movement_kernels())
+        {
+            found = found || std::strcmp(kernel.name, movement_kernel_name()) == 0;
+        }
+        CHECK(found);
+    }
+}
+
+int main()
+{
+    test_kernels_match_scalar();
+    test_selected_kernel_is_available();
+    return test_result();
+}
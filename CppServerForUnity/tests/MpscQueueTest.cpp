@@ -0,0 +1,109 @@
+#include "MpscQueue.h"
+#include "TestCheck.h"
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+// The queue rooms take player input through: pushes fail instead of overwriting when it is full,
+// and with many producers racing one consumer every value comes out exactly once, each
+// producer's in the order it pushed them.
+
+namespace
+{
+    struct Item
+    {
+        int producer = -1;
+        int sequence = 0;
+        std::string text; // owns memory, so a torn hand-over shows up under a sanitizer
+    };
+
+    void test_fifo_and_full()
+    {
+        MpscQueue<Item, 8> queue;
+        for (int round = 0; round < 100; ++round) // wraps the cells many times
+        {
+            for (int i = 0; i < 8; ++i)
+            {
+                CHECK(queue.try_push(Item{0, round * 8 + i, std::to_string(i)}));
+            }
+            Item rejected{0, -1, "kept"};
+            CHECK(!queue.try_push(std::move(rejected)));
+            CHECK(rejected.text == "kept");
+
+            int expected = round * 8;
+            const std::size_t drained = queue.drain([&](Item &item)
+                                                    {
+                CHECK(item.sequence == expected);
+                ++expected; });
+            CHECK(drained == 8);
+            CHECK(queue.drain([](Item &) {}) == 0);
+        }
+    }
+
+    void test_many_producers()
+    {
+        constexpr int kProducers = 4;
+        constexpr int kItemsEach = 200000;
+        MpscQueue<Item, 64> queue; // small, so producers keep finding it full
+        std::vector<int> next(kProducers, 0);
+        bool out_of_order = false;
+        std::atomic<int> finished{0};
+
+        std::vector<std::thread> producers;
+        for (int p = 0; p < kProducers; ++p)
+        {
+            producers.emplace_back([&queue, &finished, p]()
+                                   {
+                for (int i = 0; i < kItemsEach; ++i)
+                {
+                    Item item{p, i, std::to_string(i)};
+                    while (!queue.try_push(std::move(item)))
+                    {
+                        std::this_thread::yield();
+                    }
+                }
+                finished.fetch_add(1); });
+        }
+
+        const auto consume = [&](Item &item)
+        {
+            if (item.producer < 0 || item.producer >= kProducers || item.sequence != next[item.producer] ||
+                item.text != std::to_string(item.sequence))
+            {
+                out_of_order = true;
+            }
+            else
+            {
+                ++next[item.producer];
+            }
+        };
+        // Keep draining until every producer is done, so none of them waits forever on a full queue.
+        while (finished.load() < kProducers)
+        {
+            if (queue.drain(consume) == 0)
+            {
+                std::this_thread::yield();
+            }
+        }
+        queue.drain(consume);
+        for (auto &producer : producers)
+        {
+            producer.join();
+        }
+
+        CHECK(!out_of_order);
+        CHECK(queue.drain([](Item &) {}) == 0);
+        for (int p = 0; p < kProducers; ++p)
+        {
+            CHECK(next[p] == kItemsEach);
+        }
+    }
+}
+
+int main()
+{
+    test_fifo_and_full();
+    test_many_producers();
+    return test_result();
+}
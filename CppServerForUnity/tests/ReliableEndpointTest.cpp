@@ -0,0 +1,333 @@
+#include "ReliableEndpoint.h"
+#include "TestCheck.h"
+
+// ReliableEndpoint's delivery rules per channel, its acks across sequence wrap-around, its resend
+// timing, and giving up on a peer that stops acking.
+
+namespace
+{
+    using Clock = ReliableEndpoint::Clock;
+
+    const SharedMessage kPayload = make_message("payload");
+
+    void ignore(const PacketHeader &, const std::string &) {}
+
+    // Acks `header` from the peer's side: a bare ack packet carrying its sequence.
+    void ack(ReliableEndpoint &endpoint, const PacketHeader &header, Clock::time_point now)
+    {
+        PacketHeader reply;
+        reply.ack = header.sequence;
+        endpoint.receive(reply, {}, now, [](MessageType, std::string_view) {});
+    }
+
+    // What the receiving side delivered, in delivery order.
+    struct Receiver
+    {
+        ReliableEndpoint endpoint;
+        std::vector<std::string> delivered;
+
+        void receive(std::uint16_t sequence, Channel channel, std::uint16_t channel_sequence, const std::string &payload)
+        {
+            PacketHeader header;
+            header.sequence = sequence;
+            header.channel = channel;
+            header.channel_sequence = channel_sequence;
+            header.type = MessageType::ChatMessage;
+            endpoint.receive(header, payload, Clock::now(), [this](MessageType, std::string_view message)
+                             { delivered.emplace_back(message); });
+        }
+    };
+
+    // Sends of `type` among what update() sends at `now`.
+    int resends_at(ReliableEndpoint &endpoint, Clock::time_point now, MessageType type = MessageType::ChatBroadcast)
+    {
+        int sent = 0;
+        endpoint.update(now, [&](const PacketHeader &header, const std::string &)
+                        {
+            if (header.type == type)
+            {
+                ++sent;
+            } });
+        return sent;
+    }
+
+    void test_ordered_buffers_until_the_gap_fills()
+    {
+        Receiver receiver;
+        receiver.receive(0, Channel::ReliableOrdered, 2, "c");
+        receiver.receive(1, Channel::ReliableOrdered, 1, "b");
+        CHECK(receiver.delivered.empty());
+
+        receiver.receive(2, Channel::ReliableOrdered, 0, "a");
+        CHECK((receiver.delivered == std::vector<std::string>{"a", "b", "c"}));
+
+        // Duplicates of delivered messages, before or after the gap filled, are dropped.
+        receiver.receive(3, Channel::ReliableOrdered, 1, "b");
+        receiver.receive(4, Channel::ReliableOrdered, 4, "e");
+        receiver.receive(5, Channel::ReliableOrdered, 4, "e");
+        receiver.receive(6, Channel::ReliableOrdered, 3, "d");
+        CHECK((receiver.delivered == std::vector<std::string>{"a", "b", "c", "d", "e"}));
+    }
+
+    void test_ordered_across_channel_sequence_wraparound()
+    {
+        Receiver receiver;
+        for (std::uint16_t cs = 0; cs < 65534; ++cs)
+        {
+            receiver.receive(cs, Channel::ReliableOrdered, cs, "");
+        }
+        receiver.delivered.clear();
+
+        receiver.receive(0, Channel::ReliableOrdered, 1, "z");
+        receiver.receive(1, Channel::ReliableOrdered, 65535, "y");
+        receiver.receive(2, Channel::ReliableOrdered, 0, "w");
+        CHECK(receiver.delivered.empty());
+        receiver.receive(3, Channel::ReliableOrdered, 65534, "x");
+        CHECK((receiver.delivered == std::vector<std::string>{"x", "y", "w", "z"}));
+    }
+
+    void test_unordered_drops_duplicates()
+    {
+        Receiver receiver;
+        receiver.receive(0, Channel::ReliableUnordered, 1, "b");
+        receiver.receive(1, Channel::ReliableUnordered, 0, "a");
+        receiver.receive(2, Channel::ReliableUnordered, 1, "b");
+        receiver.receive(3, Channel::ReliableUnordered, 0, "a");
+        receiver.receive(4, Channel::ReliableUnordered, 2, "c");
+        CHECK((receiver.delivered == std::vector<std::string>{"b", "a", "c"}));
+    }
+
+    void test_sequenced_drops_stale()
+    {
+        Receiver receiver;
+        receiver.receive(0, Channel::UnreliableSequenced, 5, "5");
+        receiver.receive(1, Channel::UnreliableSequenced, 3, "3");
+        receiver.receive(2, Channel::UnreliableSequenced, 5, "5");
+        receiver.receive(3, Channel::UnreliableSequenced, 7, "7");
+        receiver.receive(4, Channel::UnreliableSequenced, 6, "6");
+        // 2 is newer than 65530 once the sequence wraps.
+        receiver.receive(5, Channel::UnreliableSequenced, 65530, "65530");
+        CHECK((receiver.delivered == std::vector<std::string>{"5", "7"}));
+
+        Receiver wrapped;
+        wrapped.receive(0, Channel::UnreliableSequenced, 65530, "65530");
+        wrapped.receive(1, Channel::UnreliableSequenced, 2, "2");
+        wrapped.receive(2, Channel::UnreliableSequenced, 65535, "65535");
+        CHECK((wrapped.delivered == std::vector<std::string>{"65530", "2"}));
+    }
+
+    // The acks sent back name the newest packet, and the bitfield the ones before it, across the
+    // wrap from 65535 to 0.
+    void test_ack_bits_across_wraparound()
+    {
+        Receiver receiver;
+        receiver.receive(65533, Channel::ReliableOrdered, 0, "");
+        receiver.receive(65535, Channel::ReliableOrdered, 1, "");
+        receiver.receive(1, Channel::ReliableOrdered, 3, "");
+        receiver.receive(0, Channel::ReliableOrdered, 2, ""); // late
+
+        PacketHeader reply;
+        int replies = 0;
+        receiver.endpoint.update(Clock::now(), [&](const PacketHeader &header, const std::string &)
+                                 {
+            reply = header;
+            ++replies; });
+        CHECK(replies == 1);
+        CHECK(reply.ack == 1);
+        // bit i acks 1 - 1 - i: 0, 65535 and 65533 arrived, 65534 did not.
+        CHECK(reply.ack_bits == 0b1011);
+
+        // On the sending side, those acks settle every packet they name.
+        ReliableEndpoint sender;
+        const auto now = Clock::now();
+        for (int i = 0; i < 65533; ++i)
+        {
+            sender.prepare(Channel::Unreliable, MessageType::GameStateUpdate, kPayload, now);
+        }
+        for (int i = 0; i < 5; ++i) // sequences 65533 to 1
+        {
+            sender.prepare(Channel::ReliableOrdered, MessageType::ChatBroadcast, kPayload, now);
+        }
+        sender.receive(reply, {}, now, [](MessageType, std::string_view) {});
+        const auto pending = sender.take_pending();
+        CHECK(pending.size() == 1); // 65534
+    }
+
+    // Resends follow RFC 6298: 200 ms before any RTT sample, then SRTT + 4 * RTTVAR clamped to
+    // 30 ms .. 1 s, doubling with each resend of the same message.
+    void test_resend_timing()
+    {
+        using std::chrono::milliseconds;
+        ReliableEndpoint endpoint;
+        const auto start = Clock::now();
+        endpoint.prepare(Channel::ReliableOrdered, MessageType::ChatBroadcast, kPayload, start);
+        CHECK(resends_at(endpoint, start + milliseconds(199)) == 0);
+        CHECK(resends_at(endpoint, start + milliseconds(200)) == 1);
+        CHECK(resends_at(endpoint, start + milliseconds(599)) == 0);
+        PacketHeader resent;
+        endpoint.update(start + milliseconds(600), [&](const PacketHeader &header, const std::string &)
+                        { resent = header; });
+        CHECK(resent.type == MessageType::ChatBroadcast);
+
+        // Karn's rule: the ack of a resent packet settles the message but takes no RTT sample.
+        ack(endpoint, resent, start + milliseconds(650));
+        CHECK(endpoint.take_pending().empty());
+        CHECK(endpoint.rtt().count() == 0);
+
+        // First sample 100 ms: SRTT 100, RTTVAR 50, timeout 300 ms.
+        auto now = start + milliseconds(1000);
+        ack(endpoint, endpoint.prepare(Channel::ReliableOrdered, MessageType::ChatBroadcast, kPayload, now), now + milliseconds(100));
+        CHECK(endpoint.rtt() == milliseconds(100));
+        now += milliseconds(200);
+        endpoint.prepare(Channel::ReliableOrdered, MessageType::ChatBroadcast, kPayload, now);
+        CHECK(resends_at(endpoint, now + milliseconds(299)) == 0);
+        CHECK(resends_at(endpoint, now + milliseconds(300)) == 1);
+        endpoint.take_pending();
+
+        // Second sample 100 ms: RTTVAR 37.5, timeout 250 ms.
+        now += milliseconds(1000);
+        ack(endpoint, endpoint.prepare(Channel::ReliableOrdered, MessageType::ChatBroadcast, kPayload, now), now + milliseconds(100));
+        now += milliseconds(200);
+        endpoint.prepare(Channel::ReliableOrdered, MessageType::ChatBroadcast, kPayload, now);
+        CHECK(resends_at(endpoint, now + milliseconds(249)) == 0);
+        CHECK(resends_at(endpoint, now + milliseconds(250)) == 1);
+        endpoint.take_pending();
+
+        // A fast link bottoms out at 30 ms.
+        for (int i = 0; i < 50; ++i)
+        {
+            now += milliseconds(10);
+            ack(endpoint, endpoint.prepare(Channel::ReliableOrdered, MessageType::ChatBroadcast, kPayload, now), now + milliseconds(1));
+        }
+        now += milliseconds(10);
+        endpoint.prepare(Channel::ReliableOrdered, MessageType::ChatBroadcast, kPayload, now);
+        CHECK(resends_at(endpoint, now + milliseconds(29)) == 0);
+        CHECK(resends_at(endpoint, now + milliseconds(30)) == 1);
+        endpoint.take_pending();
+
+        // A slow one tops out at 1 s, and so does the backoff.
+        for (int i = 0; i < 50; ++i)
+        {
+            now += milliseconds(3000);
+            ack(endpoint, endpoint.prepare(Channel::ReliableOrdered, MessageType::ChatBroadcast, kPayload, now), now + milliseconds(1500));
+        }
+        now += milliseconds(3000);
+        endpoint.prepare(Channel::ReliableOrdered, MessageType::ChatBroadcast, kPayload, now);
+        CHECK(resends_at(endpoint, now + milliseconds(999)) == 0);
+        CHECK(resends_at(endpoint, now + milliseconds(1000)) == 1);
+        CHECK(resends_at(endpoint, now + milliseconds(1999)) == 0);
+        CHECK(resends_at(endpoint, now + milliseconds(2000)) == 1);
+    }
+
+    void test_acked_messages_never_fail()
+    {
+        ReliableEndpoint endpoint;
+        auto now = Clock::now();
+        for (int i = 0; i < 1000; ++i)
+        {
+            ack(endpoint, endpoint.prepare(Channel::ReliableOrdered, MessageType::ChatBroadcast, kPayload, now), now);
+            now += std::chrono::milliseconds(10);
+            endpoint.update(now, ignore);
+        }
+        CHECK(!endpoint.failed());
+        CHECK(endpoint.take_pending().empty());
+    }
+
+    void test_gives_up_after_max_resends()
+    {
+        ReliableEndpoint endpoint;
+        auto now = Clock::now();
+        endpoint.prepare(Channel::ReliableOrdered, MessageType::UpdateRoomInfo, kPayload, now);
+        endpoint.prepare(Channel::ReliableUnordered, MessageType::ChatBroadcast, kPayload, now);
+        endpoint.prepare(Channel::UnreliableSequenced, MessageType::GameStateUpdate, kPayload, now);
+
+        int resends = 0;
+        const auto count = [&](const PacketHeader &header, const std::string &)
+        {
+            if (header.type == MessageType::UpdateRoomInfo)
+            {
+                ++resends;
+            }
+        };
+        for (int step = 0; step < 1000 && !endpoint.failed(); ++step)
+        {
+            now += std::chrono::milliseconds(10);
+            endpoint.update(now, count);
+        }
+        CHECK(endpoint.failed());
+        CHECK(resends == ReliableEndpoint::kMaxResends);
+
+        // A failed endpoint stays quiet.
+        bool sent = false;
+        endpoint.update(now + std::chrono::seconds(10), [&](const PacketHeader &, const std::string &)
+                        { sent = true; });
+        CHECK(!sent);
+
+        // Both reliable messages come back in send order; the unreliable one was never kept.
+        const auto pending = endpoint.take_pending();
+        CHECK(pending.size() == 2);
+        CHECK(pending.size() == 2 && pending[0].first == MessageType::UpdateRoomInfo && pending[1].first == MessageType::ChatBroadcast);
+        CHECK(pending.size() == 2 && pending[0].second == kPayload);
+        CHECK(endpoint.take_pending().empty());
+    }
+
+    void test_gives_up_when_pending_window_is_full()
+    {
+        ReliableEndpoint endpoint;
+        const auto now = Clock::now();
+        for (std::size_t i = 0; i < ReliableEndpoint::kMaxPending; ++i)
+        {
+            endpoint.prepare(Channel::ReliableOrdered, MessageType::ChatBroadcast, kPayload, now);
+        }
+        CHECK(!endpoint.failed());
+
+        // Unreliable messages are not held, so they do not count.
+        endpoint.prepare(Channel::Unreliable, MessageType::GameStateUpdate, kPayload, now);
+        CHECK(!endpoint.failed());
+
+        endpoint.prepare(Channel::ReliableOrdered, MessageType::ChatBroadcast, kPayload, now);
+        CHECK(endpoint.failed());
+        CHECK(endpoint.take_pending().size() == ReliableEndpoint::kMaxPending + 1);
+    }
+
+    void test_acks_keep_a_slow_peer_alive()
+    {
+        // Each message is acked only after a few resends; none reaches the limit.
+        ReliableEndpoint endpoint;
+        auto now = Clock::now();
+        for (int i = 0; i < 20; ++i)
+        {
+            PacketHeader last = endpoint.prepare(Channel::ReliableOrdered, MessageType::ChatBroadcast, kPayload, now);
+            int resends = 0;
+            while (resends < ReliableEndpoint::kMaxResends - 1)
+            {
+                now += std::chrono::milliseconds(10);
+                endpoint.update(now, [&](const PacketHeader &header, const std::string &)
+                                {
+                    if (header.type == MessageType::ChatBroadcast)
+                    {
+                        last = header;
+                        ++resends;
+                    } });
+            }
+            ack(endpoint, last, now);
+        }
+        CHECK(!endpoint.failed());
+        CHECK(endpoint.take_pending().empty());
+    }
+}
+
+int main()
+{
+    test_ordered_buffers_until_the_gap_fills();
+    test_ordered_across_channel_sequence_wraparound();
+    test_unordered_drops_duplicates();
+    test_sequenced_drops_stale();
+    test_ack_bits_across_wraparound();
+    test_resend_timing();
+    test_acked_messages_never_fail();
+    test_gives_up_after_max_resends();
+    test_gives_up_when_pending_window_is_full();
+    test_acks_keep_a_slow_peer_alive();
+    return test_result();
+}
@@ -0,0 +1,291 @@
+#include "SnapshotDelta.h"
+#include "SchemaCodec.h"
+#include "TestCheck.h"
+#include <map>
+
+// Round trips of game_state_update deltas: whatever baseline the server picks, a client that
+// applies the delta to its copy of that baseline ends up with exactly the current frame.
+
+namespace
+{
+    // A snapshot as a client holds it after decoding.
+    struct ClientFrame
+    {
+        std::uint32_t tick = 0;
+        PositionInfo origin;
+        float precision = 0;
+        std::map<std::uint32_t, QuantizedPlayerState> players; // by player id
+    };
+
+    // What a client does with a payload: start from the baseline it names, or from nothing for a
+    // full snapshot, then apply the changed entries and the removals. Throws SchemaDecodeError if
+    // the payload is malformed or names a baseline the client does not have.
+    ClientFrame apply_snapshot(std::string_view payload, const std::map<std::uint32_t, ClientFrame> &received)
+    {
+        schema_detail::BinaryReader reader(payload);
+        ClientFrame frame;
+        const auto tick = static_cast<std::uint32_t>(reader.varint());
+        const auto baseline_tick = static_cast<std::uint32_t>(reader.varint());
+        if (baseline_tick == 0)
+        {
+            frame.origin.x = reader.f32();
+            frame.origin.y = reader.f32();
+            frame.origin.z = reader.f32();
+            frame.precision = reader.f32();
+        }
+        else
+        {
+            auto baseline = received.find(baseline_tick);
+            if (baseline == received.end())
+            {
+                throw SchemaDecodeError("unknown baseline");
+            }
+            frame = baseline->second;
+        }
+        frame.tick = tick;
+
+        for (auto count = reader.varint(); count > 0; --count)
+        {
+            const EntityId id{static_cast<std::uint32_t>(reader.varint())};
+            const std::uint8_t mask = reader.u8();
+            const bool known = frame.players.count(id.value) != 0;
+            if (!known && mask != kSnapshotAllFields)
+            {
+                throw SchemaDecodeError("partial entry for a new player");
+            }
+            QuantizedPlayerState &player = frame.players[id.value];
+            player.player_id = id;
+            if (mask & kSnapshotPositionX) player.position.x = reader.u16();
+            if (mask & kSnapshotPositionY) player.position.y = reader.u16();
+            if (mask & kSnapshotPositionZ) player.position.z = reader.u16();
+            if (mask & kSnapshotForward) player.animation.forward = reader.u8();
+            if (mask & kSnapshotStrafe) player.animation.strafe = reader.u8();
+        }
+        for (auto count = reader.varint(); count > 0; --count)
+        {
+            frame.players.erase(static_cast<std::uint32_t>(reader.varint()));
+        }
+        if (reader.remaining() != 0)
+        {
+            throw SchemaDecodeError("trailing bytes");
+        }
+        return frame;
+    }
+
+    bool same_state(const QuantizedPlayerState &a, const QuantizedPlayerState &b)
+    {
+        return a.player_id == b.player_id &&
+               a.position.x == b.position.x && a.position.y == b.position.y && a.position.z == b.position.z &&
+               a.animation.forward == b.animation.forward && a.animation.strafe == b.animation.strafe;
+    }
+
+    bool matches(const ClientFrame &decoded, const SnapshotFrame &expected, const PositionQuantizer &quantizer)
+    {
+        if (decoded.tick != expected.tick || decoded.players.size() != expected.players.size() ||
+            decoded.precision != quantizer.precision || decoded.origin.x != quantizer.origin.x ||
+            decoded.origin.y != quantizer.origin.y || decoded.origin.z != quantizer.origin.z)
+        {
+            return false;
+        }
+        for (const auto &player : expected.players)
+        {
+            auto it = decoded.players.find(player.player_id.value);
+            if (it == decoded.players.end() || !same_state(it->second, player))
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    std::uint32_t baseline_tick_of(std::string_view payload)
+    {
+        schema_detail::BinaryReader reader(payload);
+        reader.varint();
+        return static_cast<std::uint32_t>(reader.varint());
+    }
+
+    QuantizedPlayerState make_player(std::uint32_t id, std::uint16_t x, std::uint8_t forward = 128)
+    {
+        return {EntityId{id}, {x, 3200, 100}, {forward, 128}};
+    }
+
+    const PositionQuantizer kQuantizer = make_position_quantizer(RoomBounds{}, kDefaultPositionPrecision);
+
+    void test_full_snapshot()
+    {
+        SnapshotFrame current{7, {make_player(1, 10), make_player(2, 20, 255)}};
+        std::string payload;
+        append_snapshot_delta(payload, kQuantizer, current, nullptr);
+        CHECK(baseline_tick_of(payload) == 0);
+        CHECK(matches(apply_snapshot(payload, {}), current, kQuantizer));
+    }
+
+    void test_delta_sends_only_changes()
+    {
+        std::map<std::uint32_t, ClientFrame> received;
+        SnapshotFrame baseline{1, {make_player(1, 10), make_player(2, 20), make_player(3, 30)}};
+        std::string full;
+        append_snapshot_delta(full, kQuantizer, baseline, nullptr);
+        received[1] = apply_snapshot(full, received);
+
+        // Only player 2 moved.
+        SnapshotFrame current{2, {make_player(1, 10), make_player(2, 21), make_player(3, 30)}};
+        std::string delta;
+        append_snapshot_delta(delta, kQuantizer, current, &baseline);
+        CHECK(baseline_tick_of(delta) == 1);
+        CHECK(matches(apply_snapshot(delta, received), current, kQuantizer));
+
+        std::string current_full;
+        append_snapshot_delta(current_full, kQuantizer, current, nullptr);
+        CHECK(delta.size() < current_full.size());
+    }
+
+    void test_join_and_leave_between_baseline_and_current()
+    {
+        std::map<std::uint32_t, ClientFrame> received;
+        SnapshotFrame baseline{10, {make_player(1, 10), make_player(2, 20), make_player(3, 30)}};
+        std::string full;
+        append_snapshot_delta(full, kQuantizer, baseline, nullptr);
+        received[10] = apply_snapshot(full, received);
+
+        // Player 2 left, player 4 joined, player 1 moved; the roster order changed too.
+        SnapshotFrame current{14, {make_player(3, 30), make_player(4, 40, 0), make_player(1, 11)}};
+        std::string delta;
+        append_snapshot_delta(delta, kQuantizer, current, &baseline);
+        const ClientFrame decoded = apply_snapshot(delta, received);
+        CHECK(matches(decoded, current, kQuantizer));
+        CHECK(decoded.players.count(2) == 0);
+
+        // Everyone left.
+        SnapshotFrame empty{15, {}};
+        std::string gone;
+        append_snapshot_delta(gone, kQuantizer, empty, &baseline);
+        CHECK(matches(apply_snapshot(gone, received), empty, kQuantizer));
+    }
+
+    void test_history_lookup()
+    {
+        SnapshotHistory history;
+        CHECK(history.find(0) == nullptr);
+        CHECK(history.find(1) == nullptr);
+
+        for (std::uint32_t tick = 1; tick <= 100; ++tick)
+        {
+            history.push(tick).players.push_back(make_player(1, static_cast<std::uint16_t>(tick)));
+        }
+        // The newest kCapacity ticks are remembered, with their own contents.
+        for (std::uint32_t tick = 100 - SnapshotHistory::kCapacity + 1; tick <= 100; ++tick)
+        {
+            const SnapshotFrame *frame = history.find(tick);
+            CHECK(frame && frame->tick == tick && frame->players.size() == 1 && frame->players[0].position.x == tick);
+        }
+        // Older ones were evicted, including the one whose slot the newest reused.
+        CHECK(history.find(100 - SnapshotHistory::kCapacity) == nullptr);
+        CHECK(history.find(1) == nullptr);
+        CHECK(history.find(0) == nullptr);
+        CHECK(history.find(101) == nullptr);
+    }
+
+    // What tick_room does for a client whose ack fell out of the history: the lookup fails and the
+    // client gets a full snapshot, which it can decode without any baseline.
+    void test_evicted_baseline_falls_back_to_full()
+    {
+        SnapshotHistory history;
+        for (std::uint32_t tick = 1; tick <= SnapshotHistory::kCapacity + 5; ++tick)
+        {
+            history.push(tick).players = {make_player(1, static_cast<std::uint16_t>(tick)), make_player(2, 7)};
+        }
+        const std::uint32_t acked_tick = 3;
+        const SnapshotFrame *baseline = history.find(acked_tick);
+        CHECK(baseline == nullptr);
+
+        const SnapshotFrame &current = *history.find(SnapshotHistory::kCapacity + 5);
+        std::string payload;
+        append_snapshot_delta(payload, kQuantizer, current, baseline);
+        CHECK(baseline_tick_of(payload) == 0);
+        CHECK(matches(apply_snapshot(payload, {}), current, kQuantizer));
+    }
+
+    // A room over many ticks, players coming and going, and clients whose acks lag, get lost or
+    // stop for so long that their baseline is evicted. Baselines are picked as tick_room picks them.
+    void test_random_session()
+    {
+        std::mt19937 rng(16);
+        std::uniform_int_distribution<int> percent(0, 99);
+        SnapshotHistory history;
+        std::vector<QuantizedPlayerState> roster;
+        std::uint32_t next_id = 1;
+
+        struct Client
+        {
+            std::map<std::uint32_t, ClientFrame> received;
+            std::uint32_t acked_tick = 0;
+        };
+        std::vector<Client> clients(4);
+        int deltas = 0, fulls = 0;
+
+        for (std::uint32_t tick = 1; tick <= 600; ++tick)
+        {
+            if (percent(rng) < 10 || roster.empty())
+            {
+                roster.push_back(make_player(next_id++, static_cast<std::uint16_t>(rng())));
+            }
+            if (percent(rng) < 8 && !roster.empty())
+            {
+                roster.erase(roster.begin() + static_cast<std::ptrdiff_t>(rng() % roster.size()));
+            }
+            for (auto &player : roster)
+            {
+                if (percent(rng) < 40) player.position.x = static_cast<std::uint16_t>(player.position.x + rng() % 5);
+                if (percent(rng) < 5) player.position.y = static_cast<std::uint16_t>(rng());
+                if (percent(rng) < 30) player.position.z = static_cast<std::uint16_t>(player.position.z - rng() % 5);
+                if (percent(rng) < 20) player.animation.forward = static_cast<std::uint8_t>(rng());
+                if (percent(rng) < 20) player.animation.strafe = static_cast<std::uint8_t>(rng());
+            }
+
+            SnapshotFrame &frame = history.push(tick);
+            frame.players = roster;
+            for (std::size_t c = 0; c < clients.size(); ++c)
+            {
+                Client &client = clients[c];
+                std::string payload;
+                append_snapshot_delta(payload, kQuantizer, frame, history.find(client.acked_tick));
+                (baseline_tick_of(payload) == 0 ? fulls : deltas)++;
+
+                // Client c loses 10 * c percent of snapshots, and client 3 goes quiet for a while.
+                if (percent(rng) < static_cast<int>(10 * c) || (c == 3 && tick > 200 && tick < 300))
+                {
+                    continue;
+                }
+                const ClientFrame decoded = apply_snapshot(payload, client.received);
+                CHECK(matches(decoded, frame, kQuantizer));
+                client.received[tick] = decoded;
+                if (percent(rng) < 70)
+                {
+                    client.acked_tick = tick; // acks can be lost too
+                }
+            }
+        }
+        CHECK(deltas > 0 && fulls > 0);
+    }
+}
+
+int main()
+{
+    try
+    {
+        test_full_snapshot();
+        test_delta_sends_only_changes();
+        test_join_and_leave_between_baseline_and_current();
+        test_history_lookup();
+        test_evicted_baseline_falls_back_to_full();
+        test_random_session();
+    }
+    catch (SchemaDecodeError &e)
+    {
+        std::cerr << "decode failed: " << e.what() << std::endl;
+        return 1;
+    }
+    return test_result();
+}
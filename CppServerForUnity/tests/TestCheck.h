@@ -0,0 +1,28 @@
+#pragma once
+
+#include <iostream>
+
+// 테스트 검사
+// The checks the test executables share. A failed CHECK reports itself and the test carries on;
+// main returns test_result(), which ctest reads as pass or fail.
+inline int g_test_failures = 0;
+
+#define CHECK(condition)                                                                   \
+    do                                                                                     \
+    {                                                                                      \
+        if (!(condition))                                                                  \
+        {                                                                                  \
+            std::cerr << __FILE__ << ":" << __LINE__ << ": CHECK(" #condition ") failed" << std::endl; \
+            ++g_test_failures;                                                             \
+        }                                                                                  \
+    } while (false)
+
+inline int test_result()
+{
+    if (g_test_failures != 0)
+    {
+        std::cerr << g_test_failures << " check(s) failed" << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,188 @@
+#include "WorkStealingPool.h"
+#include "TestCheck.h"
+#include <chrono>
+
+// The pool every room runs on: tasks must all run exactly once, idle workers must take work queued
+// on a busy one, sleeping workers must wake for new work, and shutdown must not leak or hang.
+
+namespace
+{
+    using namespace std::chrono_literals;
+
+    // Polls `done` until it holds or `timeout` passes; returns whether it held.
+    template <class Predicate>
+    bool wait_for(Predicate done, std::chrono::milliseconds timeout = 5000ms)
+    {
+        const auto deadline = std::chrono::steady_clock::now() + timeout;
+        while (!done())
+        {
+            if (std::chrono::steady_clock::now() > deadline)
+            {
+                return false;
+            }
+            std::this_thread::sleep_for(1ms);
+        }
+        return true;
+    }
+
+    void test_every_task_runs_once()
+    {
+        constexpr int kProducers = 4;
+        constexpr int kTasksEach = 10000;
+        std::vector<std::atomic<int>> runs(kProducers * kTasksEach);
+        WorkStealingPool pool(4); // declared last, so its workers are gone before what they use
+        std::vector<std::thread> producers;
+        for (int p = 0; p < kProducers; ++p)
+        {
+            producers.emplace_back([&, p]()
+                                   {
+                for (int i = 0; i < kTasksEach; ++i)
+                {
+                    asio::post(pool.get_executor(), [&runs, n = p * kTasksEach + i]()
+                               { runs[n].fetch_add(1); });
+                } });
+        }
+        for (auto &producer : producers)
+        {
+            producer.join();
+        }
+
+        CHECK(wait_for([&]()
+                       { return std::all_of(runs.begin(), runs.end(), [](const std::atomic<int> &r)
+                                            { return r.load() != 0; }); }));
+        std::this_thread::sleep_for(10ms);
+        CHECK(std::all_of(runs.begin(), runs.end(), [](const std::atomic<int> &r)
+                          { return r.load() == 1; }));
+    }
+
+    // A task queued by a worker goes onto that worker's own deque; while the worker is busy, the
+    // other one has to steal it.
+    void test_idle_worker_steals()
+    {
+        std::atomic<bool> release{false};
+        std::atomic<int> children_done{0};
+        std::atomic<bool> stolen{false};
+        WorkStealingPool pool(2);
+        asio::post(pool.get_executor(), [&]()
+                   {
+            const std::thread::id parent = std::this_thread::get_id();
+            for (int i = 0; i < 8; ++i)
+            {
+                asio::post(pool.get_executor(), [&, parent]()
+                           {
+                    if (std::this_thread::get_id() != parent)
+                    {
+                        stolen = true;
+                    }
+                    children_done.fetch_add(1); });
+            }
+            // Stay busy until the other worker has taken them all.
+            wait_for([&]()
+                     { return children_done.load() == 8 || release.load(); }); });
+
+        CHECK(wait_for([&]()
+                       { return children_done.load() == 8; }));
+        CHECK(stolen.load());
+        release = true;
+    }
+
+    // Workers that have gone to sleep must wake for every new task, including ones queued right as
+    // they are about to wait.
+    void test_sleeping_workers_wake()
+    {
+        WorkStealingPool pool(3);
+        std::this_thread::sleep_for(50ms); // every worker is asleep by now
+        for (int round = 0; round < 500; ++round)
+        {
+            std::atomic<bool> ran{false};
+            asio::post(pool.get_executor(), [&ran]()
+                       { ran = true; });
+            if (!wait_for([&ran]()
+                          { return ran.load(); }))
+            {
+                CHECK(!"task was never run");
+                return;
+            }
+            if (round % 100 == 0)
+            {
+                std::this_thread::sleep_for(20ms);
+            }
+        }
+    }
+
+    // Strands on the pool still run their handlers one at a time.
+    void test_strand_serializes()
+    {
+        constexpr int kTasks = 20000;
+        int counter = 0; // only touched on the strand
+        std::atomic<int> finished{0};
+        WorkStealingPool pool(4);
+        asio::strand<WorkStealingPool::executor_type> strand(pool.get_executor());
+        std::vector<std::thread> producers;
+        for (int p = 0; p < 4; ++p)
+        {
+            producers.emplace_back([&]()
+                                   {
+                for (int i = 0; i < kTasks / 4; ++i)
+                {
+                    asio::post(strand, [&]()
+                               {
+                        ++counter;
+                        finished.fetch_add(1); });
+                } });
+        }
+        for (auto &producer : producers)
+        {
+            producer.join();
+        }
+        CHECK(wait_for([&]()
+                       { return finished.load() == kTasks; }));
+        asio::post(strand, [&]()
+                   { finished = counter; });
+        CHECK(wait_for([&]()
+                       { return finished.load() == kTasks; }));
+    }
+
+    // Destroying the pool joins its workers, even with tasks still queued, and every task is
+    // either run or destroyed.
+    void test_shutdown()
+    {
+        {
+            WorkStealingPool idle(4);
+            std::this_thread::sleep_for(10ms);
+        } // must not hang
+
+        auto token = std::make_shared<int>(0);
+        std::atomic<bool> release{false};
+        std::atomic<int> ran{0};
+        auto pool = std::make_unique<WorkStealingPool>(1);
+        asio::post(pool->get_executor(), [&release]()
+                   { wait_for([&release]()
+                              { return release.load(); }); });
+        for (int i = 0; i < 100; ++i)
+        {
+            asio::post(pool->get_executor(), [token, &ran]()
+                       { ran.fetch_add(1); });
+        }
+
+        std::thread destroyer([&pool]()
+                              { pool.reset(); });
+        std::this_thread::sleep_for(20ms);
+        release = true;
+        destroyer.join();
+
+        CHECK(!pool);
+        CHECK(ran.load() <= 100);
+        CHECK(token.use_count() == 1);
+    }
+}
+
+int main()
+{
+    test_every_task_runs_once();
+    test_idle_worker_steals();
+    test_sleeping_workers_wake();
+    test_strand_serializes();
+    test_shutdown();
+    return test_result();
+}
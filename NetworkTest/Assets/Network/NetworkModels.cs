@@ -79,3 +79,83 @@ public class ChatBroadcastPayload
         return UnityEngine.JsonUtility.FromJson<ChatBroadcastPayload>(json);
     }
 }
+
+// 바이너리(GF-SCHEMA/1) game_state_update의 양자화 값을 되돌리는 함수들.
+// 서버의 SnapshotQuantization.h와 같은 공식을 사용합니다.
+public static class SnapshotQuantization
+{
+    // origin과 precision은 스냅샷 앞부분에 함께 옵니다.
+    public static float DequantizePosition(ushort q, float origin, float precision)
+    {
+        return origin + q * precision;
+    }
+
+    // 128이 정확히 0, 1과 255가 각각 -1과 1입니다.
+    public static float DequantizeBlend(byte q)
+    {
+        return (q - 128) / 127f;
+    }
+}
+
+// 압축 프레임(헬로에 " lz/1"을 붙여 협상)의 압축을 푸는 함수.
+// 서버의 FrameCompression.h에 적힌 형식을 따르며, 사전은 FrameCompression.cpp와 바이트 단위로 같아야 합니다.
+public static class FrameCompression
+{
+    public const string Capability = "lz/1";
+    public const ushort CompressedFrameFlag = 0x8000;
+
+    public static readonly byte[] Dictionary = System.Text.Encoding.UTF8.GetBytes(
+        "{\"message\":\"\",\"sender_id\":\"UID\",\"type\":\"chat_broadcast\"}" +
+        "{\"host_id\":\"UID\",\"players\":[{\"is_ready\":true,\"nickname\":\"\",\"player_id\":\"UID\"}," +
+        "{\"is_ready\":false,\"nickname\":\"\",\"player_id\":\"UID\"}],\"room_name\":\"\",\"type\":\"update_room_info\"}" +
+        "{\"rooms\":[{\"player_count\":1,\"room_id\":0,\"room_name\":\"\"}," +
+        "{\"player_count\":2,\"room_id\":1,\"room_name\":\"\"}],\"type\":\"find_rooms_response\"}");
+
+    public static byte[] Decompress(byte[] payload)
+    {
+        int i = 0;
+        int size = 0;
+        for (int shift = 0; ; shift += 7)
+        {
+            byte b = payload[i++];
+            size |= (b & 0x7f) << shift;
+            if (b < 0x80) break;
+        }
+
+        // 사전은 출력 앞에 이미 풀려 있는 것으로 취급합니다.
+        var output = new List<byte>(Dictionary.Length + size);
+        output.AddRange(Dictionary);
+        while (true)
+        {
+            byte token = payload[i++];
+            int literals = token >> 4;
+            if (literals == 15) literals += ReadLength(payload, ref i);
+            for (int k = 0; k < literals; k++) output.Add(payload[i++]);
+            if (i == payload.Length) break;
+
+            int offset = payload[i] | payload[i + 1] << 8;
+            i += 2;
+            int length = token & 0x0f;
+            if (length == 15) length += ReadLength(payload, ref i);
+            length += 4;
+            if (offset == 0 || offset > output.Count) throw new FormatException("bad match offset");
+            int from = output.Count - offset;
+            for (int k = 0; k < length; k++) output.Add(output[from + k]);
+        }
+
+        if (output.Count - Dictionary.Length != size) throw new FormatException("size mismatch");
+        return output.GetRange(Dictionary.Length, size).ToArray();
+    }
+
+    private static int ReadLength(byte[] payload, ref int i)
+    {
+        int length = 0;
+        byte b;
+        do
+        {
+            b = payload[i++];
+            length += b;
+        } while (b == 255);
+        return length;
+    }
+}